@@ -0,0 +1,42 @@
+# Generates a header with constexpr tables from tile_info.cfg
+# Usage: cmake -DINPUT=tile_info.cfg -DOUTPUT=tileinfodata.h -P GenerateTileInfo.cmake
+
+file(STRINGS "${INPUT}" LINES)
+set(SECTION "")
+set(LOGICAL "")
+set(VISUAL "")
+foreach(LINE ${LINES})
+    if(LINE MATCHES "^\\[(.*)\\]")
+        set(SECTION "${CMAKE_MATCH_1}")
+    elseif(LINE MATCHES "^([0-9]+) *= *\"([^\"]*)\"")
+        set(ID "${CMAKE_MATCH_1}")
+        string(REGEX REPLACE " +" ";" VALUES "${CMAKE_MATCH_2}")
+        list(LENGTH VALUES COUNT)
+        if(SECTION STREQUAL "TileInfo" AND COUNT GREATER 3)
+            # Mark the state to visual IDs as unused if they are missing
+            if(COUNT LESS 6)
+                list(APPEND VALUES -1 -1)
+            endif()
+            string(REPLACE ";" ", " VALUES "${VALUES}")
+            set(LOGICAL "${LOGICAL}    {${ID}, ${VALUES}},\n")
+        elseif(SECTION STREQUAL "VisualTiles" AND COUNT GREATER 0)
+            if(COUNT LESS 2)
+                list(APPEND VALUES 0)
+            endif()
+            string(REPLACE ";" ", " VALUES "${VALUES}")
+            set(VISUAL "${VISUAL}    {${ID}, ${VALUES}},\n")
+        endif()
+    endif()
+endforeach()
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated from ${INPUT}, do not edit\n\n"
+"#ifndef TILEINFODATA_H\n#define TILEINFODATA_H\n\n"
+"namespace TileInfoData\n{\n\n"
+"// Logical ID, Collision, CollisionTrue, LaserCollision, LaserCollisionTrue, StateToVisual, StateToVisualTrue\n"
+"constexpr int logical[][7] =\n{\n${LOGICAL}};\n\n"
+"// Visual ID, Logical ID, State\n"
+"constexpr int visual[][3] =\n{\n${VISUAL}};\n\n"
+"}\n\n#endif\n")
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
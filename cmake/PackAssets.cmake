@@ -0,0 +1,10 @@
+# Packs everything in data/ into a single archive
+# Globbing happens here (at build time), so generated files like binary levels are included
+# Usage: cmake -DPACKER=AssetPacker -DOUTPUT=assets.pack -P PackAssets.cmake (from the source directory)
+
+file(GLOB_RECURSE FILES RELATIVE "${CMAKE_CURRENT_SOURCE_DIR}" data/*)
+list(SORT FILES)
+execute_process(COMMAND "${PACKER}" "${OUTPUT}" ${FILES} RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "Failed to pack assets")
+endif()
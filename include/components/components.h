@@ -87,6 +87,7 @@ struct AABB: public es::Component
         // component does not change when the object moves around.
     std::vector<es::ID> collisions; // IDs of currently colliding world
     std::vector<int> tileCollisions; // Tile IDs of currently colliding tiles (could be in alternate world)
+        // Note: These are only changed by the physics system when a collision begins or ends
 
     void load(const std::string& str)
     {
@@ -471,6 +472,12 @@ struct Rigid: public es::Component
     static constexpr auto name = "Rigid";
 };
 
+// Determines if laser beams are stopped by this entity (needs an AABB component)
+struct BlocksLaser: public es::Component
+{
+    static constexpr auto name = "BlocksLaser";
+};
+
 // Excludes an object from being saved in a level file
 struct ExcludeFromLevel: public es::Component
 {
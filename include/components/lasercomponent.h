@@ -22,9 +22,12 @@ struct Laser: public es::Component
         Left
     };
 
+    // A straight part of the laser beam, between the laser and a mirror or anything else it hits
     struct Beam
     {
-        sf::Sprite sprite;
+        sf::Vector2f start;
+        sf::Vector2f end;
+        sf::Vector2i direction;
         int layer;
     };
 
@@ -34,7 +37,7 @@ struct Laser: public es::Component
     static const std::map<std::string, int> directionMap;
 
     std::vector<Beam> beams;
-    unsigned beamCount{0};
+    bool looped{false}; // If the beams go around a loop of mirrors (the beams stop where the loop closes)
     sf::Vector2i direction;
     std::string directionStr;
 
@@ -0,0 +1,65 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <atomic>
+#include "mappedfile.h"
+
+/*
+A single archive file containing many files, which is memory mapped when opened.
+The format (all integers are 32-bit unsigned unless noted, in native byte order):
+    Header: "MVPK", version, entry count
+    For each entry: name length, name, offset (64-bit), size (64-bit), checksum
+    The contents of all of the files (offsets are from the start of the archive)
+Checksums are verified the first time each file is accessed (files can be accessed from any thread).
+*/
+class AssetPack
+{
+    public:
+        struct File
+        {
+            std::string name;
+            std::string data;
+        };
+
+        AssetPack();
+
+        // Opens an archive and reads its index
+        bool open(const std::string& filename);
+        void close();
+        bool isOpen() const;
+
+        // Gets the contents of a file without copying it, returns false if it doesn't exist or is corrupt
+        bool find(const std::string& name, const char*& data, std::size_t& size) const;
+
+        // Returns the names of all of the files in the archive
+        std::vector<std::string> getNames() const;
+
+        // Writes an archive containing files
+        static bool write(const std::string& filename, const std::vector<File>& files);
+
+        static std::uint32_t checksum(const char* data, std::size_t size);
+
+        static const char MAGIC[4];
+        static const unsigned VERSION;
+
+    private:
+        struct Entry
+        {
+            std::uint64_t offset{};
+            std::uint64_t size{};
+            std::uint32_t checksum{};
+            mutable std::atomic<bool> verified{false};
+        };
+
+        MappedFile archive;
+        std::unordered_map<std::string, Entry> entries;
+};
+
+#endif
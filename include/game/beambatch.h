@@ -0,0 +1,34 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef BEAMBATCH_H
+#define BEAMBATCH_H
+
+#include <SFML/Graphics.hpp>
+#include "lasercomponent.h"
+
+/*
+Holds the laser beams of every laser as textured quads, in one vertex array per layer.
+The vertices are only rebuilt when the beams change, and each layer is drawn with a single draw call.
+*/
+class BeamBatch
+{
+    public:
+        BeamBatch();
+
+        // Rebuild the vertices (call clear, then add every beam)
+        void clear();
+        void add(const Laser::Beam& beam);
+
+        // Draws the beams of a layer
+        void draw(sf::RenderTarget& target, int layer) const;
+
+    private:
+        static const char* textureFilename;
+
+        const sf::Texture* texture;
+        sf::Vector2f textureSize;
+        sf::VertexArray vertices[2];
+};
+
+#endif
@@ -0,0 +1,66 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include <vector>
+#include <cstdint>
+
+/*
+A 2D grid of bits, packed 64 to a word.
+Each row starts on a new word, so a span of a row can be tested a word at a time.
+*/
+class BitPlane
+{
+    public:
+        using Word = std::uint64_t;
+        static const unsigned WORD_BITS = 64;
+
+        BitPlane();
+
+        // Resizes the grid, new bits are always false
+        void resize(unsigned width, unsigned height, bool preserve = true);
+        void clear();
+        unsigned width() const;
+        unsigned height() const;
+
+        // Access a single bit
+        bool get(unsigned x, unsigned y) const;
+        void set(unsigned x, unsigned y, bool value);
+
+        // Returns true if any bit in a row is set, from startX to endX (inclusive)
+        bool any(unsigned y, unsigned startX, unsigned endX) const;
+
+        // Returns the first/last set bit in a row from startX to endX (inclusive), or -1 if none are set
+        int findFirst(unsigned y, unsigned startX, unsigned endX) const;
+        int findLast(unsigned y, unsigned startX, unsigned endX) const;
+
+        // Direct access to the words of a row
+        Word* getRow(unsigned y);
+        const Word* getRow(unsigned y) const;
+        unsigned getWordsPerRow() const;
+
+    private:
+        unsigned planeWidth;
+        unsigned planeHeight;
+        unsigned wordsPerRow;
+        std::vector<Word> words;
+};
+
+inline bool BitPlane::get(unsigned x, unsigned y) const
+{
+    return ((words[y * wordsPerRow + x / WORD_BITS] >> (x % WORD_BITS)) & 1);
+}
+
+inline void BitPlane::set(unsigned x, unsigned y, bool value)
+{
+    auto& word = words[y * wordsPerRow + x / WORD_BITS];
+    Word mask = (Word(1) << (x % WORD_BITS));
+    if (value)
+        word |= mask;
+    else
+        word &= ~mask;
+}
+
+#endif
@@ -0,0 +1,219 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef CHUNKEDGRID_H
+#define CHUNKEDGRID_H
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+
+/*
+A 2D grid of values, split up into square chunks.
+Chunks are only allocated when a non-default value is written to them,
+    until then they all point to one shared empty chunk.
+Chunks are shared between copies of a grid, and are copied when written to.
+*/
+template <typename T>
+class ChunkedGrid
+{
+    public:
+        static const unsigned CHUNK_BITS = 4;
+        static const unsigned CHUNK_SIZE = (1 << CHUNK_BITS);
+
+        ChunkedGrid();
+
+        // Resizes the grid, new values are always default
+        void resize(unsigned width, unsigned height, bool preserve = true);
+        void clear();
+        unsigned width() const;
+        unsigned height() const;
+
+        // Access a single value
+        T get(unsigned x, unsigned y) const;
+        void set(unsigned x, unsigned y, T value);
+
+        // Returns the values from a position to the end of its row in the chunk
+        const T* getRow(unsigned x, unsigned y) const;
+
+        // Access chunks (these are in chunk coordinates)
+        unsigned chunksWide() const;
+        unsigned chunksHigh() const;
+        bool isChunkEmpty(unsigned chunkX, unsigned chunkY) const;
+
+    private:
+        using Chunk = std::array<T, CHUNK_SIZE * CHUNK_SIZE>;
+        using ChunkPtr = std::shared_ptr<Chunk>;
+
+        static const ChunkPtr& getEmptyChunk();
+        static unsigned getChunkIndex(unsigned x, unsigned y);
+
+        // Makes sure a chunk is not shared with anything else, so it can be written to
+        Chunk& getWritableChunk(unsigned index);
+
+        // Resets the values of a chunk from a local position to the end of the chunk
+        void clearColumns(unsigned index, unsigned startX);
+        void clearRows(unsigned index, unsigned startY);
+
+        unsigned gridWidth;
+        unsigned gridHeight;
+        unsigned chunkColumns;
+        unsigned chunkRows;
+        std::vector<ChunkPtr> chunks;
+};
+
+template <typename T>
+ChunkedGrid<T>::ChunkedGrid():
+    gridWidth(0),
+    gridHeight(0),
+    chunkColumns(0),
+    chunkRows(0)
+{
+}
+
+template <typename T>
+void ChunkedGrid<T>::resize(unsigned width, unsigned height, bool preserve)
+{
+    unsigned newColumns = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    unsigned newRows = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<ChunkPtr> newChunks(newColumns * newRows, getEmptyChunk());
+
+    if (preserve)
+    {
+        // Chunks stay at the same position, so only the pointers need to move
+        unsigned columns = std::min(newColumns, chunkColumns);
+        unsigned rows = std::min(newRows, chunkRows);
+        for (unsigned y = 0; y < rows; ++y)
+        {
+            for (unsigned x = 0; x < columns; ++x)
+                newChunks[y * newColumns + x] = std::move(chunks[y * chunkColumns + x]);
+        }
+    }
+
+    chunks.swap(newChunks);
+    unsigned oldWidth = gridWidth;
+    unsigned oldHeight = gridHeight;
+    gridWidth = width;
+    gridHeight = height;
+    chunkColumns = newColumns;
+    chunkRows = newRows;
+
+    if (preserve)
+    {
+        // Cut off any values in partial chunks that are now outside of the grid
+        if (width < oldWidth && width % CHUNK_SIZE)
+        {
+            for (unsigned y = 0; y < chunkRows; ++y)
+                clearColumns(y * chunkColumns + chunkColumns - 1, width % CHUNK_SIZE);
+        }
+        if (height < oldHeight && height % CHUNK_SIZE)
+        {
+            for (unsigned x = 0; x < chunkColumns; ++x)
+                clearRows((chunkRows - 1) * chunkColumns + x, height % CHUNK_SIZE);
+        }
+    }
+}
+
+template <typename T>
+void ChunkedGrid<T>::clear()
+{
+    std::fill(chunks.begin(), chunks.end(), getEmptyChunk());
+}
+
+template <typename T>
+unsigned ChunkedGrid<T>::width() const
+{
+    return gridWidth;
+}
+
+template <typename T>
+unsigned ChunkedGrid<T>::height() const
+{
+    return gridHeight;
+}
+
+template <typename T>
+inline T ChunkedGrid<T>::get(unsigned x, unsigned y) const
+{
+    return (*chunks[(y >> CHUNK_BITS) * chunkColumns + (x >> CHUNK_BITS)])[getChunkIndex(x, y)];
+}
+
+template <typename T>
+void ChunkedGrid<T>::set(unsigned x, unsigned y, T value)
+{
+    unsigned index = (y >> CHUNK_BITS) * chunkColumns + (x >> CHUNK_BITS);
+
+    // Empty chunks don't need to be allocated to hold a default value
+    if (chunks[index] == getEmptyChunk() && value == T())
+        return;
+
+    getWritableChunk(index)[getChunkIndex(x, y)] = value;
+}
+
+template <typename T>
+const T* ChunkedGrid<T>::getRow(unsigned x, unsigned y) const
+{
+    return chunks[(y >> CHUNK_BITS) * chunkColumns + (x >> CHUNK_BITS)]->data() + getChunkIndex(x, y);
+}
+
+template <typename T>
+unsigned ChunkedGrid<T>::chunksWide() const
+{
+    return chunkColumns;
+}
+
+template <typename T>
+unsigned ChunkedGrid<T>::chunksHigh() const
+{
+    return chunkRows;
+}
+
+template <typename T>
+bool ChunkedGrid<T>::isChunkEmpty(unsigned chunkX, unsigned chunkY) const
+{
+    return (chunks[chunkY * chunkColumns + chunkX] == getEmptyChunk());
+}
+
+template <typename T>
+const typename ChunkedGrid<T>::ChunkPtr& ChunkedGrid<T>::getEmptyChunk()
+{
+    static const ChunkPtr emptyChunk = std::make_shared<Chunk>(Chunk{});
+    return emptyChunk;
+}
+
+template <typename T>
+inline unsigned ChunkedGrid<T>::getChunkIndex(unsigned x, unsigned y)
+{
+    return ((y & (CHUNK_SIZE - 1)) << CHUNK_BITS) + (x & (CHUNK_SIZE - 1));
+}
+
+template <typename T>
+typename ChunkedGrid<T>::Chunk& ChunkedGrid<T>::getWritableChunk(unsigned index)
+{
+    auto& chunk = chunks[index];
+    if (chunk.use_count() > 1)
+        chunk = std::make_shared<Chunk>(*chunk);
+    return *chunk;
+}
+
+template <typename T>
+void ChunkedGrid<T>::clearColumns(unsigned index, unsigned startX)
+{
+    if (chunks[index] == getEmptyChunk())
+        return;
+    auto& chunk = getWritableChunk(index);
+    for (unsigned y = 0; y < CHUNK_SIZE; ++y)
+        std::fill(chunk.begin() + y * CHUNK_SIZE + startX, chunk.begin() + (y + 1) * CHUNK_SIZE, T());
+}
+
+template <typename T>
+void ChunkedGrid<T>::clearRows(unsigned index, unsigned startY)
+{
+    if (chunks[index] == getEmptyChunk())
+        return;
+    auto& chunk = getWritableChunk(index);
+    std::fill(chunk.begin() + startY * CHUNK_SIZE, chunk.end(), T());
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef COMPOSITELAYER_H
+#define COMPOSITELAYER_H
+
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
+
+class TileMapData;
+class MagicWindow;
+namespace ng { class TileMap; }
+
+/*
+The tile layer that can be seen at every tile position of the real world.
+This is the real world with the alternate world overlaid inside of the magic window,
+    which is what collision and laser beams in the real world interact with.
+When the window changes, only the tiles in its old and new footprints are rebuilt.
+*/
+class CompositeLayer
+{
+    public:
+        CompositeLayer(TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow);
+
+        // Rebuilds everything (needed after loading or resizing a level)
+        void reset();
+
+        // Rebuilds the footprints of the window if it changed
+        void update();
+
+        // Returns which layer is visible at a tile position (0 if out of bounds)
+        int getLayer(unsigned x, unsigned y) const;
+
+        // Returns the rectangle of tiles using the alternate world (empty if there are none)
+        const sf::IntRect& getWindowArea() const;
+
+    private:
+        // A rectangle of tiles, which may contain tiles outside of the window
+        struct Footprint
+        {
+            unsigned left{};
+            unsigned top{};
+            unsigned right{};
+            unsigned bottom{};
+            bool empty{true};
+        };
+
+        Footprint getFootprint() const;
+        void fill(const Footprint& footprint, bool useWindow);
+
+        TileMapData& tileMapData;
+        ng::TileMap& tileMap;
+        MagicWindow& magicWindow;
+
+        unsigned width;
+        unsigned height;
+        std::vector<unsigned char> layers;
+
+        // The state of the window the last time the layer was built
+        Footprint lastFootprint;
+        sf::IntRect windowArea;
+        sf::FloatRect lastBounds;
+        bool lastVisible;
+};
+
+#endif
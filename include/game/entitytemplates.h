@@ -0,0 +1,88 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef ENTITYTEMPLATES_H
+#define ENTITYTEMPLATES_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include "es/world.h"
+
+/*
+Creates entities from prototypes and serialized components, like the ones in level files.
+Prototypes are copied with typed copies. Component strings are parsed straight into the entity,
+    and strings that are used more than once are kept as typed components, so after that
+    they are applied with a typed copy instead of being parsed again.
+Component types must be registered (before any entities are created) to be cached,
+    other components are always parsed.
+Each instance has its own cache and is not locked, so Level keeps one next to its world.
+*/
+class EntityTemplates
+{
+    public:
+        template <typename... Comps>
+        static void registerComponents();
+
+        // Creates an entity from a prototype, and applies serialized components to it
+        es::Entity create(es::World& world, const std::string& prototype, const std::string& name,
+            const std::vector<std::string>& components);
+
+        // Removes all of the cached components (called when loading a level)
+        void clear();
+
+    private:
+        // A parsed component, which can be copied onto any entity
+        struct Template
+        {
+            virtual ~Template() {}
+            virtual void apply(es::Entity& ent) const = 0;
+        };
+
+        template <typename T>
+        struct TypedTemplate: public Template
+        {
+            explicit TypedTemplate(const T& component): component(component) {}
+            void apply(es::Entity& ent) const { ent.assign<T>(component); }
+            T component;
+        };
+
+        using TemplatePtr = std::unique_ptr<const Template>;
+        using MakeFunc = TemplatePtr (*)(const es::Entity&);
+        using MakeFuncMap = std::unordered_map<std::string, MakeFunc>;
+
+        static MakeFuncMap& getMakeFuncs();
+
+        template <typename T>
+        static TemplatePtr makeTemplate(const es::Entity& ent);
+
+        template <typename T>
+        static void registerComponent();
+
+        // Strings that were only seen once have a null template
+        std::unordered_map<std::string, TemplatePtr> parsed;
+};
+
+template <typename... Comps>
+void EntityTemplates::registerComponents()
+{
+    // Expands to registerComponent<T>() for every type
+    int unused[] = {0, (registerComponent<Comps>(), 0)...};
+    (void) unused;
+}
+
+template <typename T>
+EntityTemplates::TemplatePtr EntityTemplates::makeTemplate(const es::Entity& ent)
+{
+    auto comp = ent.getPtr<T>();
+    return TemplatePtr(comp ? new TypedTemplate<T>(*comp) : nullptr);
+}
+
+template <typename T>
+void EntityTemplates::registerComponent()
+{
+    getMakeFuncs()[T::name] = &makeTemplate<T>;
+}
+
+#endif
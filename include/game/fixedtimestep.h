@@ -0,0 +1,37 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef FIXEDTIMESTEP_H
+#define FIXEDTIMESTEP_H
+
+/*
+Runs a simulation at a fixed tick rate, independent of the frame rate.
+The time of each frame is accumulated, and used up in whole ticks.
+The leftover time is used to interpolate between the last two ticks when drawing.
+*/
+class FixedTimestep
+{
+    public:
+        explicit FixedTimestep(float tickRate = 60.0f, unsigned maxTicksPerFrame = 8);
+
+        void setTickRate(float tickRate);
+        void setMaxTicksPerFrame(unsigned maxTicks);
+        float getTickTime() const;
+
+        // Adds the time of a frame, and returns the number of ticks to run
+        // If the simulation falls too far behind, the extra time is dropped
+        unsigned addFrameTime(float dt);
+
+        // Returns how far the frame is between the last two ticks (0 to 1)
+        float getAlpha() const;
+
+        // Drops any accumulated time
+        void reset();
+
+    private:
+        float tickTime;
+        unsigned maxTicks;
+        float accumulator;
+};
+
+#endif
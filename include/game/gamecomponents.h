@@ -0,0 +1,13 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef GAMECOMPONENTS_H
+#define GAMECOMPONENTS_H
+
+/*
+Registers every component type used in levels, and loads the entity prototypes.
+Returns false if the prototypes could not be loaded.
+*/
+bool setupGameComponents();
+
+#endif
@@ -65,6 +65,32 @@ struct MovingEvent
 
 struct GameFinishedEvent {};
 
+// Sent by the physics system when two entities start or stop touching (once per pair)
+struct CollisionBeganEvent
+{
+    es::ID entityId;
+    es::ID otherId;
+};
+
+struct CollisionEndedEvent
+{
+    es::ID entityId;
+    es::ID otherId;
+};
+
+// Sent by the physics system when an entity starts or stops touching a non-empty tile
+struct TileCollisionBeganEvent
+{
+    es::ID entityId;
+    int tileId;
+};
+
+struct TileCollisionEndedEvent
+{
+    es::ID entityId;
+    int tileId;
+};
+
 // These events are used by the level editor
 struct TileSelectionEvent
 {
@@ -10,7 +10,11 @@
 #include "nage/graphics/camera.h"
 #include "level.h"
 #include "levelloader.h"
+#include "levelsnapshot.h"
+#include "positionhistory.h"
 #include "magicwindow.h"
+#include "compositelayer.h"
+#include "beambatch.h"
 #include "nage/misc/matrix.h"
 #include "es/systemcontainer.h"
 #include "nage/actions/actionhandler.h"
@@ -33,7 +37,11 @@ struct GameInstance
     Level level;
     LevelLoader levelLoader;
     MagicWindow magicWindow;
+    CompositeLayer compositeLayer;
+    BeamBatch beamBatch;
     es::World world;
+    LevelSnapshot levelSnapshot;
+    PositionHistory positionHistory;
     es::SystemContainer systems;
 };
 
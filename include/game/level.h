@@ -5,9 +5,12 @@
 #define LEVEL_H
 
 #include <string>
+#include <unordered_map>
 #include <SFML/System/Vector2.hpp>
 #include "configfile.h"
 #include "es/world.h"
+#include "leveldata.h"
+#include "entitytemplates.h"
 
 namespace ng { class TileMap; }
 class TileMapData;
@@ -20,6 +23,7 @@ This class loads data from level files:
     Game instance
 
 Note that it does not store this data, only populates other objects with the data.
+Levels can also be loaded from the binary format, see LevelData.
 
 The current level file format looks like this:
     height = 12
@@ -48,11 +52,14 @@ class Level
 
         // Loads a level file
         bool loadFromFile(const std::string& filename);
+        bool loadFromBinaryFile(const std::string& filename);
         void loadFromString(const std::string& data);
+        void load(const LevelData& data);
 
         // Saves a level file
         bool saveToFile(const std::string& filename) const;
         void saveToString(std::string& data) const;
+        void save(LevelData& data) const;
 
         // Resets tilemaps and world
         void clear();
@@ -61,23 +68,28 @@ class Level
         const std::string& getName() const;
 
         // Loads world from a section in a config file
+        // Levels can be loaded on several threads, but entities are only created on one thread at a time
         static void loadEntities(cfg::File::Section& section, es::World& world);
+        static void loadEntities(const std::vector<LevelData::Entity>& entities, es::World& world,
+            EntityTemplates& templates);
 
     private:
 
         // Loading levels
         void load(cfg::File& config);
-        void loadLogicalLayer(cfg::File& config, int layer);
-        void loadVisualLayer(cfg::File& config, int layer);
-        void loadTileMap(cfg::File& config);
-        void loadEntities(cfg::File& config);
+        void loadTileMap(const LevelData& data);
 
         // Saving levels
         void save(cfg::File& config) const;
-        void saveTileMap(cfg::File& config) const;
-        void saveEntities(cfg::File& config) const;
+        void saveTileMap(LevelData& data) const;
+        void saveEntities(LevelData& data) const;
+        void saveEntity(const es::Entity& ent, const std::vector<std::string>& comps, LevelData::Entity& entity) const;
 
-        static const cfg::File::ConfigMap defaultOptions;
+        // Forgets the saved entities and prototype components (called when loading or clearing a level)
+        void clearSaveCache();
+
+        // Returns a serialized component of a prototype (cached until the next level is loaded)
+        const std::string& getPrototypeComponent(const std::string& prototype, const std::string& compName) const;
 
         TileMapData& tileMapData; // Logical tile map
         ng::TileMap& tileMap; // Visual tile map
@@ -86,6 +98,16 @@ class Level
         MagicWindow& magicWindow;
 
         std::string name;
+        EntityTemplates templates;
+
+        // Entities from the last save by name, which are reused if their serialized components are the same
+        struct SavedEntity
+        {
+            std::vector<std::string> comps;
+            LevelData::Entity entity;
+        };
+        mutable std::unordered_map<std::string, SavedEntity> savedEntities;
+        mutable std::unordered_map<std::string, std::string> prototypeComponents;
 };
 
 #endif
@@ -0,0 +1,66 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef LEVELDATA_H
+#define LEVELDATA_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "configfile.h"
+
+/*
+The contents of a level file, independent of the game objects it gets loaded into.
+Can be read from and written to both the text format (see Level), and a binary format.
+
+The binary format (all integers are 32-bit unsigned unless noted, in native byte order):
+    Header: "MVLB", version, width, height, entity count, name length, name
+    For each layer (real, then alternate):
+        Logical IDs (8-bit, width * height)
+        Visual IDs (16-bit, width * height)
+    For each entity:
+        Name length, name, prototype length, prototype, component count
+        For each component: length, serialized component
+*/
+struct LevelData
+{
+    struct Entity
+    {
+        std::string name;
+        std::string prototype;
+        std::vector<std::string> components;
+
+        bool operator==(const Entity& other) const;
+    };
+
+    // Resizes and clears all of the tiles
+    void resize(unsigned newWidth, unsigned newHeight);
+
+    // Text format (the config file should use the default options below)
+    // Returns false if any tile rows had the wrong size or invalid IDs (those tiles are 0)
+    bool loadFromConfig(cfg::File& config);
+    void saveToConfig(cfg::File& config) const;
+    static void loadEntities(cfg::File::Section& section, std::vector<Entity>& entities);
+
+    // Binary format
+    bool loadFromBinary(const char* data, std::size_t size);
+    bool loadFromBinaryFile(const std::string& filename);
+    void saveToBinary(std::string& data) const;
+    bool saveToBinaryFile(const std::string& filename) const;
+
+    bool operator==(const LevelData& other) const;
+    bool operator!=(const LevelData& other) const;
+
+    static const cfg::File::ConfigMap defaultOptions;
+    static const char BINARY_MAGIC[4];
+    static const unsigned BINARY_VERSION;
+
+    std::string name;
+    unsigned width{};
+    unsigned height{};
+    std::vector<std::uint8_t> logicalIds[2];
+    std::vector<std::uint16_t> visualIds[2];
+    std::vector<Entity> entities;
+};
+
+#endif
@@ -5,6 +5,9 @@
 #define LEVELLOADER_H
 
 #include <string>
+#include <future>
+#include <vector>
+#include "leveldata.h"
 
 class Level;
 class GameSaveHandler;
@@ -14,6 +17,8 @@ Handles the loading and numbering of internal levels.
 Also handles saving the current level the player is on.
     Note: May support multiple slots in the future.
 Can determine if the game is completed when loading a level.
+Binary levels are used instead of text levels when they are up to date.
+While a level is being played, the next level is read on another thread.
 */
 class LevelLoader
 {
@@ -38,6 +43,7 @@ class LevelLoader
 
         // Returns the filename from a level ID
         std::string getLevelFilename(int levelId) const;
+        std::string getBinaryLevelFilename(int levelId) const;
 
         // Erases the level string in memory (so it won't be in "test mode" anymore)
         void clear();
@@ -46,10 +52,33 @@ class LevelLoader
         // Saves the configuration file storing the current level
         void updateCurrentLevel(int levelId);
 
+        // Starts reading a level file on another thread
+        void prefetch(int levelId);
+
+        // Gets the prefetched level data (waiting for it if needed), returns false if it wasn't prefetched or failed
+        bool takePrefetched(int levelId, LevelData& data);
+
+        // Reads a level file into level data (safe to call from any thread)
+        static bool readLevel(const std::string& filename, const std::string& binaryFilename, LevelData& data);
+
+        // Returns true if a file exists, and was not modified before another file
+        static bool isNewerOrSame(const std::string& filename, const std::string& otherFilename);
+
+        struct PrefetchResult
+        {
+            bool loaded{false};
+            LevelData data;
+        };
+
         Level& level;
         GameSaveHandler& gameSave;
         std::string levelDir;
         std::string levelData;
+
+        // The next level being read in the background
+        std::future<PrefetchResult> prefetched;
+        std::vector<std::future<PrefetchResult>> abandoned; // Prefetches of other levels that may still be running
+        int prefetchedLevelId;
 };
 
 #endif
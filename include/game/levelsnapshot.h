@@ -0,0 +1,42 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef LEVELSNAPSHOT_H
+#define LEVELSNAPSHOT_H
+
+#include "tilemapdata.h"
+#include "es/world.h"
+
+class TileMapChanger;
+class MagicWindow;
+
+/*
+A copy of a level right after it was loaded and initialized.
+Used to restart a level without reading or parsing the level file again.
+Note: The smooth tile map is not included, since logical IDs don't change during the game.
+*/
+class LevelSnapshot
+{
+    public:
+        LevelSnapshot(TileMapData& tileMapData, TileMapChanger& tileMapChanger, es::World& world, MagicWindow& magicWindow);
+
+        // Saves the current state of the level
+        void save();
+
+        // Restores the saved state, returns false if nothing was saved
+        bool restore();
+
+        void clear();
+
+    private:
+        TileMapData& tileMapData;
+        TileMapChanger& tileMapChanger;
+        es::World& world;
+        MagicWindow& magicWindow;
+
+        TileMapData::Snapshot tiles;
+        es::World entities;
+        bool saved;
+};
+
+#endif
@@ -55,6 +55,9 @@ class MagicWindow: public sf::Drawable, public sf::Transformable
         bool isWithin(const sf::Vector2u& pos) const;
         bool isWithin(const sf::FloatRect& aabb) const;
 
+        // Returns the area covered by the window (even when hidden)
+        sf::FloatRect getBounds() const;
+
         // Set/get state
         void show(bool state);
         bool isVisible() const;
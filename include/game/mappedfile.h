@@ -0,0 +1,44 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+A read-only view of an entire file.
+Uses a memory mapping where it is supported, otherwise the file is read into a buffer.
+*/
+class MappedFile
+{
+    public:
+        MappedFile();
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Returns true if the file was opened successfully
+        bool open(const std::string& filename);
+        void close();
+        bool isOpen() const;
+
+        // The contents of the file (only valid while it is open)
+        const char* data() const;
+        std::size_t size() const;
+
+    private:
+        bool readIntoBuffer(const std::string& filename);
+
+        const char* fileData;
+        std::size_t fileSize;
+        bool mapped;
+        bool opened;
+        std::vector<char> buffer;
+};
+
+#endif
@@ -0,0 +1,37 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef POSITIONHISTORY_H
+#define POSITIONHISTORY_H
+
+#include <unordered_map>
+#include <SFML/System/Vector2.hpp>
+#include "es/world.h"
+
+/*
+Stores the positions of entities from before the last simulation tick,
+    so they can be drawn between the last two ticks.
+Entities without a stored position are drawn where they currently are.
+*/
+class PositionHistory
+{
+    public:
+        explicit PositionHistory(es::World& world);
+
+        // Stores the current positions (call this before every tick)
+        void save();
+        void clear();
+
+        // Sets how far between the last two ticks to draw (0 to 1)
+        void setAlpha(float newAlpha);
+
+        // Returns the position of an entity to draw at
+        sf::Vector2f get(es::Entity& ent) const;
+
+    private:
+        es::World& world;
+        std::unordered_map<es::ID, sf::Vector2f> positions;
+        float alpha;
+};
+
+#endif
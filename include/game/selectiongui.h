@@ -62,6 +62,7 @@ class SelectionGUI: public sf::Drawable
         sf::View view;
         sf::View textureView;
         sf::Font font;
+        std::string fontData;
         sf::Vector2f borderSize;
         sf::RectangleShape border;
         sf::RectangleShape currentSelection;
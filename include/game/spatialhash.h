@@ -0,0 +1,70 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <vector>
+#include <unordered_map>
+#include <SFML/Graphics/Rect.hpp>
+#include "es/internal/id.h"
+
+/*
+A uniform grid of cells, stored sparsely in a hash map.
+Entities are kept in every cell that their bounding box touches, and are only
+    moved between cells when their cell range changes.
+Used as a broadphase, so only entities sharing a cell need to be tested exactly.
+*/
+class SpatialHash
+{
+    public:
+        SpatialHash();
+
+        // Changing the cell size removes everything
+        void setCellSize(const sf::Vector2u& size);
+        void clear();
+
+        // Call update() for every entity between these, anything not updated is removed
+        void beginUpdate();
+        void endUpdate();
+
+        // Inserts or moves an entity, returns true if its cells changed
+        bool update(es::ID id, const sf::FloatRect& bounds);
+        void remove(es::ID id);
+
+        // Appends the IDs of all entities sharing a cell with the bounds (no duplicates)
+        void query(const sf::FloatRect& bounds, std::vector<es::ID>& results) const;
+
+    private:
+        struct CellRange
+        {
+            int left{};
+            int top{};
+            int right{};
+            int bottom{};
+
+            bool operator==(const CellRange& other) const;
+            bool operator!=(const CellRange& other) const;
+        };
+
+        struct Item
+        {
+            CellRange cells;
+            unsigned stamp{};
+        };
+
+        using Key = long long;
+        using Cell = std::vector<es::ID>;
+
+        CellRange getCellRange(const sf::FloatRect& bounds) const;
+        static Key getKey(int x, int y);
+        void insertCells(es::ID id, const CellRange& range);
+        void removeCells(es::ID id, const CellRange& range);
+
+        sf::Vector2f cellSize;
+        std::unordered_map<Key, Cell> cells;
+        std::unordered_map<es::ID, Item> items;
+        unsigned currentStamp;
+};
+
+#endif
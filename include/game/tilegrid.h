@@ -0,0 +1,72 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef TILEGRID_H
+#define TILEGRID_H
+
+#include <string>
+#include <limits>
+
+/*
+Reads and writes rows of tile IDs in the level text format (integers separated by spaces).
+Rows are parsed in place and written into a reusable buffer, so nothing is allocated per tile or row.
+*/
+namespace TileGrid
+{
+    // Parses an integer and moves begin to the character after it
+    // Returns false for invalid numbers and numbers that don't fit in an int (value is set to 0)
+    bool readInt(const char*& begin, const char* end, int& value);
+
+    // Appends an integer to a buffer
+    void writeInt(std::string& buffer, int value);
+
+    // Parses a row into values (only up to count values are stored), returns the number of values in the row
+    // Invalid numbers and numbers that don't fit in T are counted in invalid, and stored as 0
+    template <typename T>
+    unsigned readRow(const char* begin, const char* end, T* values, unsigned count, unsigned& invalid)
+    {
+        unsigned index = 0;
+        invalid = 0;
+        while (begin != end)
+        {
+            if (*begin == ' ' || *begin == '\t')
+                ++begin;
+            else
+            {
+                int value = 0;
+                if (!readInt(begin, end, value) ||
+                    static_cast<long long>(value) < static_cast<long long>(std::numeric_limits<T>::min()) ||
+                    static_cast<long long>(value) > static_cast<long long>(std::numeric_limits<T>::max()))
+                {
+                    value = 0;
+                    ++invalid;
+                }
+                if (index < count)
+                    values[index] = value;
+                ++index;
+            }
+        }
+        return index;
+    }
+
+    template <typename T>
+    unsigned readRow(const std::string& row, T* values, unsigned count, unsigned& invalid)
+    {
+        return readRow(row.data(), row.data() + row.size(), values, count, invalid);
+    }
+
+    // Replaces the contents of a buffer with a row of values
+    template <typename T>
+    void writeRow(std::string& buffer, const T* values, unsigned count)
+    {
+        buffer.clear();
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (i > 0)
+                buffer += ' ';
+            writeInt(buffer, values[i]);
+        }
+    }
+}
+
+#endif
@@ -27,6 +27,9 @@ class TileMapChanger
         // Derives other tile layer information
         void updateVisualTile(int tileId);
 
+        // Updates the visual tile map from the logical tile map (without resizing)
+        void updateVisualTiles();
+
         // Resizes both tile maps, and re-populates the visual tiles
         void resize(int width, int height);
 
@@ -35,7 +38,7 @@ class TileMapChanger
 
     private:
 
-        // Applies a function to every tile
+        // Applies a function to every tile (except in chunks of empty tiles)
         using FuncType = std::function<void(unsigned, unsigned)>;
         void apply(FuncType callback);
 
@@ -7,8 +7,11 @@
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <vector>
+#include <cstdint>
 #include <SFML/System/Vector2.hpp>
-#include "nage/misc/matrix.h"
+#include "bitplane.h"
+#include "chunkedgrid.h"
 
 // Holds all of the information for a tile
 struct Tile
@@ -22,9 +25,62 @@ struct Tile
     void reset();
 };
 
+class TileMapData;
+
+/*
+A reference to a tile stored in a TileMapData, which can be used like a Tile.
+The fields of a tile are stored in separate arrays, so each field is a small proxy.
+Note: Copying a TileRef refers to the same tile, assigning copies the values.
+*/
+class TileRef
+{
+    public:
+        enum FieldType
+        {
+            LogicalId = 0,
+            VisualId,
+            Collidable,
+            BlocksLaser,
+            State
+        };
+
+        template <typename T, int Type>
+        class Field
+        {
+            public:
+                Field(TileMapData& data, int layer, unsigned index):
+                    data(data), layer(layer), index(index) {}
+                Field(const Field& other) = default;
+                operator T() const;
+                Field& operator=(T value);
+                Field& operator=(const Field& other);
+
+            private:
+                TileMapData& data;
+                int layer;
+                unsigned index;
+        };
+
+        TileRef(TileMapData& data, int layer, unsigned index);
+        TileRef(const TileRef& other) = default;
+        TileRef& operator=(const TileRef& other);
+        TileRef& operator=(const Tile& tile);
+        operator Tile() const;
+        void reset();
+
+        Field<int, LogicalId> logicalId;
+        Field<int, VisualId> visualId;
+        Field<bool, Collidable> collidable;
+        Field<bool, BlocksLaser> blocksLaser;
+        Field<bool, State> state;
+};
+
 /*
 A logical tile map in memory (not graphical)
 Note that this is specific to the game.
+The tiles are stored as a structure of arrays: chunked grids for the IDs,
+    and bit planes for the collision, laser collision, and state flags.
+Chunks of empty tiles are never allocated, so mostly empty levels stay small.
 */
 class TileMapData
 {
@@ -33,14 +89,37 @@ class TileMapData
         TileMapData();
 
         // Access tiles
-        Tile& operator()(int layer, unsigned x, unsigned y);
-        Tile& operator()(unsigned x, unsigned y);
-        Tile& operator()(int id);
+        TileRef operator()(int layer, unsigned x, unsigned y);
+        TileRef operator()(unsigned x, unsigned y);
+        TileRef operator()(int id);
+
+        // Access tiles (const, returns a copy)
+        Tile operator()(int layer, unsigned x, unsigned y) const;
+        Tile operator()(unsigned x, unsigned y) const;
+        Tile operator()(int id) const;
 
-        // Access tiles (const)
-        const Tile& operator()(int layer, unsigned x, unsigned y) const;
-        const Tile& operator()(unsigned x, unsigned y) const;
-        const Tile& operator()(int id) const;
+        // Access single fields of tiles (faster than the above)
+        int getLogicalId(int layer, unsigned x, unsigned y) const;
+        int getVisualId(int layer, unsigned x, unsigned y) const;
+        bool isCollidable(int layer, unsigned x, unsigned y) const;
+        bool blocksLaser(int layer, unsigned x, unsigned y) const;
+        bool getState(int layer, unsigned x, unsigned y) const;
+
+        // Returns true if any tile in a row is collidable, from startX to endX (inclusive)
+        bool anyCollidable(int layer, unsigned y, unsigned startX, unsigned endX) const;
+
+        // Returns how many tiles from a position the first tile blocking lasers is in a direction
+        // Only count tiles are checked (which must be in bounds), and count is returned if none block lasers
+        unsigned findLaserBlocker(int layer, unsigned x, unsigned y, const sf::Vector2i& direction, unsigned count) const;
+
+        // Access the bit planes directly
+        const BitPlane& getCollisionPlane(int layer) const;
+        const BitPlane& getLaserPlane(int layer) const;
+
+        // Generic field access, used by TileRef
+        // Logical IDs must be under 256 and visual IDs under 65536, other IDs are not stored
+        int getField(int type, int layer, unsigned index) const;
+        void setField(int type, int layer, unsigned index, int value);
 
         // Size and layers
         void resize(unsigned width, unsigned height, bool preserve = true);
@@ -51,6 +130,14 @@ class TileMapData
         bool inBounds(int tileId) const;
         void useLayer(int layer);
 
+        // Calls a function with the position of every tile in a layer, skipping chunks of empty tiles
+        template <typename Func>
+        void forEachTile(int layer, Func callback) const;
+
+        // Same as above, but calls the function with the area of each chunk (end is exclusive)
+        template <typename Func>
+        void forEachChunk(int layer, Func callback) const;
+
         // Compute tile IDs
         int getId(unsigned x, unsigned y) const;
         int getId(int layer, unsigned x, unsigned y) const;
@@ -64,16 +151,43 @@ class TileMapData
         void updateState(int id);
         void updateState(Tile& tile);
 
-        // Tiles with world on top
+        // Tiles with world on top (clearing is constant time)
         void addTile(int id);
         bool findTile(int id) const;
         void clearTiles();
 
-        // Tile IDs
-        using TileList = std::vector<int>;
-        TileList& operator[](int logicalId);
+        // Log of tiles that changed state, so systems only need to look at what changed
+        // Each reader keeps its own cursor, and the log is emptied when the whole map changes (or it gets too long)
+        struct ChangeCursor
+        {
+            unsigned epoch{};
+            std::size_t position{};
+        };
+        void logChange(int id);
+
+        // Calls a function with every tile ID logged since the last time the cursor was used
+        // Returns false if the log was emptied since then (anything could have changed)
+        template <typename Func>
+        bool readChanges(ChangeCursor& cursor, Func callback) const;
+
+        // Tile IDs of each logical ID (except empty and normal tiles)
+        struct TileList
+        {
+            const int* first;
+            const int* last;
+            const int* begin() const { return first; }
+            const int* end() const { return last; }
+            std::size_t size() const { return (last - first); }
+        };
+        TileList operator[](int logicalId) const;
+        void buildTileIds();
         void clearTileIds();
 
+        // Copies of the level specific data (tile IDs are shared until changed)
+        struct Snapshot;
+        void saveSnapshot(Snapshot& snapshot) const;
+        void restoreSnapshot(const Snapshot& snapshot);
+
         // These are needed to extract information from the ID
         int getLayer(int id) const;
         unsigned getX(int id) const;
@@ -87,21 +201,53 @@ class TileMapData
 
     private:
 
-        // Populates the maps from a config file
+        // Populates the lookup tables from a config file (or the built-in tables)
         void loadTileInfo();
+        void addTileInfo(int logicalId, const int* values, unsigned count);
+        void addVisualInfo(int visualId, int logicalId, bool state);
+
+        // Bounds checked lookups (unknown IDs have no collision, and a state of -1)
+        const auto& getTileInfo(int logicalId) const;
+        int getVisualState(int visualId) const;
+
+        // Derives information for a single tile
+        void updateVisualId(int layer, unsigned x, unsigned y);
+        void updateCollision(int layer, unsigned x, unsigned y);
+        void updateState(int layer, unsigned x, unsigned y);
 
 
         // Level specific ----------------------------------------------------
 
-        // Tile map
-        ng::Matrix<Tile> tiles[2];
+        // Tile map (one per layer)
+        struct Layer
+        {
+            ChunkedGrid<std::uint8_t> logicalIds;
+            ChunkedGrid<std::uint16_t> visualIds;
+            BitPlane collidable;
+            BitPlane blocksLaser;
+            BitPlane laserColumns; // Same as blocksLaser, but transposed so columns can be scanned by word
+            BitPlane state;
+        };
+        Layer layers[2];
+        unsigned mapWidth;
+        unsigned mapHeight;
         int currentLayer;
 
-        // Map of logical IDs to lists of tile IDs
-        std::map<int, TileList> tileIds;
+        // Lists of tile IDs for each logical ID, stored contiguously
+        // The tile IDs of a logical ID are from tileIdOffsets[id] to tileIdOffsets[id + 1]
+        std::vector<unsigned> tileIdOffsets;
+        std::vector<int> tileIdList;
+
+        // Tile IDs with world currently on top of them have the current stamp
+        std::vector<unsigned> objectStamps;
+        unsigned currentObjectStamp;
 
-        // All of the tile IDs with world currently on top of them
-        std::set<int> tilesWithObjectsOnTop;
+        // Tiles that changed state since the log was last emptied
+        // Readers catch up every tick, so the log is emptied when it reaches the limit instead of growing forever
+        static const unsigned MAX_CHANGE_LOG = 4096;
+        std::vector<int> changeLog;
+        unsigned changeLogEpoch;
+        void clearChangeLog();
 
 
         // Game specific -----------------------------------------------------
@@ -123,16 +269,118 @@ class TileMapData
             bool stateToVisualUsed{false};
         };
 
+        // Every possible logical and visual ID has an entry, so these can be indexed directly
+        static const unsigned LOGICAL_ID_COUNT = 256;
+        static const unsigned VISUAL_ID_COUNT = 65536;
+
         // Used to lookup information about a particular logical ID (tile type)
-        std::unordered_map<int, TileInfo> logicalToInfo;
+        std::vector<TileInfo> logicalToInfo;
+
+        // Visual ID -> State lookup (-1 for unknown visual IDs)
+        std::vector<signed char> visualToState;
 
-        // Visual ID -> Logical ID lookup
+        // Visual ID -> Logical ID lookup, sorted by visual ID (used by the editor)
         struct VisualInfo
         {
             int logicalId{};
             bool state{false};
         };
-        std::unordered_map<int, VisualInfo> visualToInfo;
+        std::map<int, VisualInfo> visualToInfo;
 };
 
+struct TileMapData::Snapshot
+{
+    Layer layers[2];
+    unsigned mapWidth{};
+    unsigned mapHeight{};
+    std::vector<unsigned> tileIdOffsets;
+    std::vector<int> tileIdList;
+};
+
+template <typename T, int Type>
+TileRef::Field<T, Type>::operator T() const
+{
+    return static_cast<T>(data.getField(Type, layer, index));
+}
+
+template <typename T, int Type>
+TileRef::Field<T, Type>& TileRef::Field<T, Type>::operator=(T value)
+{
+    data.setField(Type, layer, index, value);
+    return *this;
+}
+
+template <typename T, int Type>
+TileRef::Field<T, Type>& TileRef::Field<T, Type>::operator=(const Field& other)
+{
+    return (*this = static_cast<T>(other));
+}
+
+template <typename Func>
+bool TileMapData::readChanges(ChangeCursor& cursor, Func callback) const
+{
+    bool continuous = (cursor.epoch == changeLogEpoch && cursor.position <= changeLog.size());
+    if (!continuous)
+    {
+        cursor.epoch = changeLogEpoch;
+        cursor.position = 0;
+    }
+    for (; cursor.position < changeLog.size(); ++cursor.position)
+        callback(changeLog[cursor.position]);
+    return continuous;
+}
+
+template <typename Func>
+void TileMapData::forEachTile(int layer, Func callback) const
+{
+    forEachChunk(layer, [&](unsigned startX, unsigned startY, unsigned endX, unsigned endY)
+    {
+        for (unsigned y = startY; y < endY; ++y)
+        {
+            for (unsigned x = startX; x < endX; ++x)
+                callback(x, y);
+        }
+    });
+}
+
+template <typename Func>
+void TileMapData::forEachChunk(int layer, Func callback) const
+{
+    const auto& tiles = layers[layer];
+    const unsigned chunkSize = ChunkedGrid<std::uint8_t>::CHUNK_SIZE;
+    for (unsigned chunkY = 0; chunkY < tiles.logicalIds.chunksHigh(); ++chunkY)
+    {
+        for (unsigned chunkX = 0; chunkX < tiles.logicalIds.chunksWide(); ++chunkX)
+        {
+            if (tiles.logicalIds.isChunkEmpty(chunkX, chunkY) && tiles.visualIds.isChunkEmpty(chunkX, chunkY))
+                continue;
+
+            // Only go up to the edges of the map
+            unsigned endX = std::min((chunkX + 1) * chunkSize, mapWidth);
+            unsigned endY = std::min((chunkY + 1) * chunkSize, mapHeight);
+            callback(chunkX * chunkSize, chunkY * chunkSize, endX, endY);
+        }
+    }
+}
+
+inline const auto& TileMapData::getTileInfo(int logicalId) const
+{
+    return logicalToInfo[static_cast<unsigned>(logicalId) < LOGICAL_ID_COUNT ? logicalId : 0];
+}
+
+inline int TileMapData::getVisualState(int visualId) const
+{
+    return (static_cast<unsigned>(visualId) < VISUAL_ID_COUNT ? visualToState[visualId] : -1);
+}
+
+inline bool TileMapData::isCollidable(int layer, unsigned x, unsigned y) const
+{
+    return layers[layer].collidable.get(x, y);
+}
+
+inline bool TileMapData::blocksLaser(int layer, unsigned x, unsigned y) const
+{
+    return layers[layer].blocksLaser.get(x, y);
+}
+
 #endif
@@ -0,0 +1,51 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef VIRTUALFILESYSTEM_H
+#define VIRTUALFILESYSTEM_H
+
+#include <string>
+#include <cstddef>
+#include "configfile.h"
+
+class MappedFile;
+
+/*
+Reads game data either from loose files or from a mounted asset pack.
+Loose files take priority so data can still be edited during development,
+    unless PACKED_ASSETS_ONLY is defined, in which case only the pack is used.
+Files in the pack are accessed directly from the memory mapped archive.
+*/
+class VirtualFileSystem
+{
+    public:
+        // Mounts an asset pack, returns false if it could not be opened
+        static bool mount(const std::string& filename);
+        static void unmount();
+        static bool isMounted();
+
+        static bool exists(const std::string& filename);
+
+        // Copies the contents of a file into a string
+        static bool read(const std::string& filename, std::string& data);
+
+        // Gets a view of a file in the pack, or maps a loose file into looseFile
+        // The view is valid until the pack is unmounted, or looseFile is closed
+        static bool getView(const std::string& filename, const char*& data, std::size_t& size, MappedFile& looseFile);
+
+        // Loads a config file through the file system
+        static bool loadConfig(const std::string& filename, cfg::File& config);
+
+        // Loads any resource with a loadFromMemory function (like fonts)
+        // The data is kept in a string, since some resources need it to stay around
+        template <typename T>
+        static bool loadResource(const std::string& filename, T& resource, std::string& data);
+};
+
+template <typename T>
+bool VirtualFileSystem::loadResource(const std::string& filename, T& resource, std::string& data)
+{
+    return (read(filename, data) && resource.loadFromMemory(data.data(), data.size()));
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+/*
+A fixed set of threads that split up the iterations of a loop.
+The calling thread also works on the loop, and run() returns when every iteration is done.
+Iterations are handed out one at a time, so they can take different amounts of time.
+*/
+class WorkerPool
+{
+    public:
+        using Task = std::function<void(std::size_t)>;
+
+        // Uses one thread per core by default (including the calling thread)
+        explicit WorkerPool(unsigned threadCount = 0);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // Calls task(i) for every i from 0 to count - 1, and waits for all of them to finish
+        void run(std::size_t count, const Task& task);
+
+        // The number of threads working on a loop (including the calling thread)
+        unsigned size() const;
+
+    private:
+        void workerLoop();
+        void work();
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+
+        // The current loop
+        const Task* currentTask;
+        std::size_t taskCount;
+        std::atomic<std::size_t> nextIndex;
+        unsigned busyWorkers;
+        unsigned generation;
+        bool stopping;
+};
+
+#endif
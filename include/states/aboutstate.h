@@ -25,6 +25,7 @@ class AboutState: public ng::BaseState
         std::vector<sf::Text> textList;
         sf::Sprite bgSprite;
         sf::Font font;
+        std::string fontData;
 };
 
 #endif
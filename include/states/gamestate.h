@@ -6,12 +6,14 @@
 
 #include "nage/states/basestate.h"
 #include "gameinstance.h"
+#include "fixedtimestep.h"
 
 class GameResources;
 
 /*
 The state for the playable game.
 Contains the game world, world, and systems.
+The simulation systems run at a fixed tick rate, and the drawing systems run once per frame.
 */
 class GameState: public ng::BaseState
 {
@@ -24,8 +26,15 @@ class GameState: public ng::BaseState
         void draw() {} // Update() calls the render system to draw
 
     private:
+        // Runs one fixed tick of the simulation systems
+        void updateSimulation(float tickTime);
+
+        // Starts the simulation over after loading or restarting a level
+        void resetSimulation();
+
         GameResources& resources;
         GameInstance gameInstance;
+        FixedTimestep timestep;
 };
 
 #endif
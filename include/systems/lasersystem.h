@@ -9,19 +9,30 @@
 #include "lasercomponent.h"
 #include "es/system.h"
 #include "es/world.h"
+#include "tilemapdata.h"
+#include "spatialhash.h"
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
 
 namespace ng { class TileMap; }
-class TileMapData;
 class MagicWindow;
+class CompositeLayer;
+class BeamBatch;
 
 /*
 Handles creating laser beams from lasers.
 Also handles the collision and redirection of the beams.
+The beams of each laser are cached, and only traced again when a tile along
+    them changes, the laser changes, or the magic window moves over them.
+Laser sensors are only switched when they start or stop being hit.
+Entities with a BlocksLaser component stop the beams, and are found with a ray
+    query against a spatial hash of each world, so only entities near a beam are tested.
 */
 class LaserSystem: public es::System
 {
     public:
-        LaserSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow);
+        LaserSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow, CompositeLayer& compositeLayer, BeamBatch& beamBatch);
         void initialize();
         void update(float dt);
 
@@ -34,7 +45,8 @@ class LaserSystem: public es::System
             {
                 Stop,
                 Redirect,
-                Activate
+                Activate,
+                Loop // Hit a mirror the beam already went through the same way
             };
 
             PointInfo(): state(State::Stop), tileId(0) {}
@@ -44,29 +56,94 @@ class LaserSystem: public es::System
             int tileId; // The tile being hit
         };
 
+        // The tiles crossed by a single beam (in tile coordinates)
+        struct Segment
+        {
+            sf::IntRect area;
+            bool usesWindow; // If the layer of the tiles depends on the magic window
+        };
+
+        // The beams of a laser from the last time they were traced
+        struct BeamPath
+        {
+            bool valid{false};
+            sf::Vector2u start;
+            sf::Vector2i direction;
+            int layer{};
+            std::vector<Segment> segments;
+            std::vector<int> sensors; // Laser sensors hit by the beams
+            unsigned stamp{};
+        };
+
+        // Removes cached paths that changed tiles or the magic window could affect
+        void invalidatePaths();
+        void invalidatePaths(const sf::FloatRect& bounds, bool windowOnly);
+        bool isPathCurrent(const BeamPath& path, const Laser& laser, const TilePosition& tilePos) const;
+
+        // Sends switch events for the laser sensors that started or stopped being hit
+        void updateSensors();
+
         PointInfo findPoint();
-        void addBeams(Laser& laser, TilePosition& tilePos);
+
+        // Updates the spatial hashes of entities blocking lasers, and removes paths near any that changed
+        void updateBlockers();
+
+        // Finds the nearest entity blocking the beam within a number of tiles on a layer, starting at the current position
+        bool findBlocker(int layer, unsigned count, PointInfo& point);
+
+        // Returns false if the beam already hit a mirror going the same direction on the same layer
+        bool visitMirror(int tileId);
+
+        // Returns how many tiles the beam crosses on the same layer, and sets which layer that is
+        unsigned getRunLength(int& layer) const;
+        void addBeams(Laser& laser, TilePosition& tilePos, BeamPath& path);
         int getLayer() const;
         void changeDirection(bool state, sf::Vector2i& direction) const;
 
-        static const char* textureFilename;
+        // Most beams a single laser can have (the beams stop after this)
+        static const unsigned MAX_BEAMS = 256;
 
         // References
         es::World& world;
         TileMapData& tileMapData;
         ng::TileMap& tileMap;
         MagicWindow& magicWindow;
+        CompositeLayer& compositeLayer;
+        BeamBatch& beamBatch;
 
         // Game/level information
         sf::Vector2u tileSize;
         sf::Vector2u mapSize;
-        unsigned beamWidth;
+
+        // Cached beams of each laser entity
+        std::unordered_map<es::ID, BeamPath> beamPaths;
+        unsigned currentStamp;
+        bool beamsChanged; // If the vertices of the beams and the laser sensors need to be updated
+        TileMapData::ChangeCursor changeCursor;
+        sf::FloatRect lastWindowBounds;
+        bool lastWindowVisible;
+
+        // Entities blocking lasers, with a spatial hash for each world
+        struct Blocker
+        {
+            sf::FloatRect bounds;
+            bool worlds[2]; // Which worlds the entity is in
+            unsigned stamp{};
+        };
+        std::unordered_map<es::ID, Blocker> blockers;
+        SpatialHash blockerHashes[2];
+        std::vector<es::ID> candidates;
 
         // Used temporarily for making the beams
         sf::Vector2i currentPosition;
         sf::Vector2i currentDirection;
         int currentLayer;
-        std::set<int> laserSensorsToDisable;
+        std::vector<std::uint64_t> visitedMirrors; // Tile ID, direction, and layer of each mirror hit
+        std::vector<int> activeSensors;
+
+        // Laser sensors hit by the beams (sorted), and if every sensor needs to be set
+        std::vector<int> litSensors;
+        bool syncSensors;
 };
 
 #endif
@@ -8,34 +8,125 @@
 #include "components.h"
 #include "es/system.h"
 #include "es/world.h"
+#include "spatialhash.h"
+#include "tilemapdata.h"
+#include "workerpool.h"
+#include <memory>
 
 namespace ng { class TileMap; }
-class TileMapData;
 class MagicWindow;
+class CompositeLayer;
 class Level;
 
 /*
 This class handles applying the velocity to all of the entities' positions.
 It also detects and handles collision.
+Contacts between entities (and tiles) are cached, and only checked again when an entity moves,
+    changes worlds, or the magic window moves. Events are sent when contacts begin or end.
+Entities that stay at rest for a while are put to sleep, and skip all of their physics
+    until something could move them (see shouldWake()).
+Entities are stepped independently, so large numbers of them are split between threads.
+    Anything shared is buffered per entity and merged in query order, so the results are
+    exactly the same as stepping them on one thread.
 */
 class PhysicsSystem: public es::System
 {
     public:
-        PhysicsSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow, Level& level);
+        PhysicsSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow,
+                CompositeLayer& compositeLayer, Level& level);
         void initialize();
         void update(float dt);
 
+        // Sets the number of threads used to step entities (0 is one per core, 1 is serial)
+        static void setThreadCount(unsigned count);
+
     private:
+        struct StepBody;
+
         void stepPositions(float dt);
-        void handleTileCollision(AABB* entAABB, float& velocity, Position* position,
-                bool vertical, es::ID entityId, bool altWorld);
-        void updateEdgeCases(Position* position, Size* size, float& velocity, es::ID entityId);
+        void stepBody(StepBody& body, float dt) const;
+        float sweepTiles(const sf::FloatRect& bounds, float delta, bool vertical, bool altWorld) const;
+        bool isBlocked(unsigned mainIndex, unsigned crossStart, unsigned crossEnd, bool vertical, bool altWorld) const;
+        void handleTileCollision(StepBody& body, float& velocity, bool vertical) const;
+        void updateEdgeCases(StepBody& body) const;
         void checkEntityCollisions();
         void checkTileCollisions();
+        void removeOldBodies();
+        void beginContact(unsigned index, es::ID otherId);
+        void endContact(es::ID entityId, es::ID otherId);
+        void addCollision(es::ID entityId, es::ID otherId);
+        void removeCollision(es::ID entityId, es::ID otherId);
+        bool windowMoved();
         int determineLayer(bool altWorld, bool aboveWindow, unsigned x, unsigned y) const;
         void updateTilePositionComponents();
-        void updateOnPlatformState(es::ID entityId, int state);
-        void getCollidingTiles(const sf::FloatRect& entAABB, sf::Vector2u& start, sf::Vector2u& end);
+        void getCollidingTiles(const sf::FloatRect& entAABB, sf::Vector2u& start, sf::Vector2u& end) const;
+
+        // Per-frame information about an entity used for entity collisions
+        struct CollisionBody
+        {
+            es::ID id;
+            AABB* aabb;
+            sf::FloatRect bounds;
+            bool altWorld;
+            bool drawOnTop;
+            bool inWindow;
+            bool moved; // Contacts need to be checked again
+            bool tilesChanged; // Tile contacts need to be checked again
+        };
+
+        // Persistent information about an entity from the last time it was checked
+        struct BodyState
+        {
+            sf::FloatRect bounds;
+            bool altWorld{};
+            bool drawOnTop{};
+            bool inWindow{};
+            unsigned stamp{};
+            std::vector<es::ID> contacts;
+            std::vector<int> tiles;
+        };
+
+        static bool canCollide(const CollisionBody& body, const CollisionBody& body2);
+
+        // Information about an entity that may be sleeping
+        struct SleepState
+        {
+            unsigned restingTicks{};
+            bool asleep{};
+            bool woken{};
+            Position position;
+            sf::FloatRect bounds;
+            bool altWorld{};
+            std::vector<int> restingTiles; // Tiles this entity is on top of
+        };
+
+        bool shouldWake(const StepBody& body) const;
+        void updateSleep(StepBody& body, const Position& oldPosition) const;
+        void wakeFromTileChanges();
+
+        // The components of an entity being stepped, and the shared things it changes
+        // Only the entity's own components are changed during the step, the rest is merged after
+        struct StepBody
+        {
+            es::ID id;
+            Velocity* velocity;
+            Position* position;
+            Size* size;
+            AABB* aabb;
+            Gravity* gravity;
+            ObjectState* objectState;
+            SleepState* sleep;
+            bool altWorld;
+            bool aboveWindow;
+            std::vector<int> restingTiles; // Tiles with this entity on top of them
+        };
+
+        // Entities are only split between threads if there are at least this many per thread
+        static const unsigned BODIES_PER_TASK = 64;
+        static unsigned threadCount;
+
+        // How many ticks an entity needs to be at rest before sleeping
+        static const unsigned SLEEP_TICKS = 30;
 
         // These are used for gravity and falling
         static const sf::Vector2f maxVelocity;
@@ -46,7 +137,33 @@ class PhysicsSystem: public es::System
         TileMapData& tileMapData;
         ng::TileMap& tileMap;
         MagicWindow& magicWindow;
+        CompositeLayer& compositeLayer;
         Level& level;
+
+        // Broadphase for entity collisions (reused every frame)
+        SpatialHash broadphase;
+        std::vector<CollisionBody> bodies;
+        std::unordered_map<es::ID, unsigned> bodyIndices;
+        std::vector<es::ID> candidateIds;
+        std::vector<unsigned> candidates;
+
+        // Contact cache
+        std::unordered_map<es::ID, BodyState> bodyStates;
+        unsigned currentStamp;
+        std::vector<es::ID> newContacts;
+        std::vector<es::ID> oldContacts;
+        std::vector<int> newTiles;
+        sf::FloatRect lastWindowBounds;
+        bool lastWindowVisible;
+
+        // Sleeping
+        std::unordered_map<es::ID, SleepState> sleepStates;
+        TileMapData::ChangeCursor changeCursor;
+        std::vector<int> changedTiles;
+
+        // Stepping
+        std::vector<StepBody> stepBodies;
+        std::unique_ptr<WorkerPool> workers;
 };
 
 #endif
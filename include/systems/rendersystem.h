@@ -18,6 +18,7 @@ namespace ng
 }
 
 class MagicWindow;
+class BeamBatch;
 class Level;
 class GameSaveHandler;
 
@@ -28,14 +29,11 @@ It will render all of the drawable world like the tile map, and drawable compone
 class RenderSystem: public es::System
 {
     public:
-        RenderSystem(es::World& world, ng::TileMap& tileMap, ng::TileMap& smoothTileMap, sf::RenderWindow& window, ng::Camera& camera, MagicWindow& magicWindow, const Level& level, const GameSaveHandler& gameSave);
+        RenderSystem(es::World& world, ng::TileMap& tileMap, ng::TileMap& smoothTileMap, sf::RenderWindow& window, ng::Camera& camera, MagicWindow& magicWindow, const BeamBatch& beamBatch, const Level& level, const GameSaveHandler& gameSave);
         void initialize();
         void update(float dt);
 
     private:
-        // Draws laser beams
-        void drawLasers(int layer);
-
         template <class SpriteType>
         void drawSprite(es::Entity& ent, bool onTop = false);
 
@@ -46,6 +44,7 @@ class RenderSystem: public es::System
         sf::RenderWindow& window;
         ng::Camera& camera;
         MagicWindow& magicWindow;
+        const BeamBatch& beamBatch;
         const Level& level;
         const GameSaveHandler& gameSave;
 
@@ -53,6 +52,7 @@ class RenderSystem: public es::System
         ng::SpriteLoader sprites;
 
         sf::Font font;
+        std::string fontData;
         sf::View uiView;
         sf::Text levelNumberText;
         sf::Text levelNameText;
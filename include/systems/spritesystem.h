@@ -12,23 +12,26 @@ namespace es
     class Entity;
     class World;
 }
+class PositionHistory;
 
 /*
 This class handles updating the sprite positions from the position components.
+Sprites are drawn between the last two simulation ticks, and so is the camera.
 */
 class SpriteSystem: public es::System
 {
     public:
-        SpriteSystem(es::World& world);
+        SpriteSystem(es::World& world, const PositionHistory& positionHistory);
         void update(float dt);
 
         static void updateRotations(es::World& world);
 
     private:
-        static void setPosition(es::Entity& ent, sf::Transformable& sprite);
+        void setPosition(es::Entity& ent, sf::Transformable& sprite);
         static void setRotation(es::Entity& ent, sf::Transformable& sprite);
 
         es::World& world;
+        const PositionHistory& positionHistory;
 };
 
 #endif
@@ -24,6 +24,7 @@ class TileSmoothingSystem: public es::System
 
     private:
         void updateTile(int layer, int x, int y);
+        int getBlankTile(int layer) const;
         char getKey(int layer, int x, int y) const;
 
         cfg::File mappings;
@@ -5,6 +5,9 @@
 #define TILESYSTEM_H
 
 #include "es/system.h"
+#include "es/internal/id.h"
+#include <unordered_map>
+#include <vector>
 
 class TileMapData;
 namespace es
@@ -16,11 +19,13 @@ namespace es
 /*
 This class handles the action key presses for the special tiles.
 It then proxies the events so other things can handle what happened.
+The special tiles each entity is touching are tracked from the tile collision events.
 */
 class TileSystem: public es::System
 {
     public:
         TileSystem(es::World& world, TileMapData& tileMapData);
+        void initialize();
         void update(float dt);
 
     private:
@@ -28,6 +33,9 @@ class TileSystem: public es::System
 
         es::World& world;
         TileMapData& tileMapData;
+
+        // Tiles with actions that each entity is touching
+        std::unordered_map<es::ID, std::vector<int>> actionTiles;
 };
 
 #endif
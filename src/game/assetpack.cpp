@@ -0,0 +1,176 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "assetpack.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const char AssetPack::MAGIC[4] = {'M', 'V', 'P', 'K'};
+const unsigned AssetPack::VERSION = 1;
+
+namespace
+{
+
+template <typename T>
+bool readValue(const char*& pos, const char* end, T& value)
+{
+    if (static_cast<std::size_t>(end - pos) < sizeof(T))
+        return false;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+template <typename T>
+void writeValue(std::string& data, T value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+AssetPack::AssetPack()
+{
+}
+
+bool AssetPack::open(const std::string& filename)
+{
+    close();
+    if (!archive.open(filename))
+        return false;
+
+    // Check the header
+    const char* pos = archive.data();
+    const char* end = pos + archive.size();
+    std::uint32_t version = 0;
+    std::uint32_t count = 0;
+    if (archive.size() < sizeof(MAGIC) || std::memcmp(pos, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        close();
+        return false;
+    }
+    pos += sizeof(MAGIC);
+    if (!readValue(pos, end, version) || version != VERSION || !readValue(pos, end, count))
+    {
+        close();
+        return false;
+    }
+
+    // Read the index
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::uint32_t nameLength = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        std::uint32_t fileChecksum = 0;
+        if (!readValue(pos, end, nameLength) || static_cast<std::size_t>(end - pos) < nameLength)
+        {
+            close();
+            return false;
+        }
+        std::string name(pos, nameLength);
+        pos += nameLength;
+        if (!readValue(pos, end, offset) || !readValue(pos, end, size) ||
+            !readValue(pos, end, fileChecksum) || offset > archive.size() ||
+            size > archive.size() - offset)
+        {
+            close();
+            return false;
+        }
+
+        // Entries are built in place, since the verified flag can't be copied
+        auto& entry = entries[name];
+        entry.offset = offset;
+        entry.size = size;
+        entry.checksum = fileChecksum;
+        entry.verified = false;
+    }
+
+    return true;
+}
+
+void AssetPack::close()
+{
+    archive.close();
+    entries.clear();
+}
+
+bool AssetPack::isOpen() const
+{
+    return archive.isOpen();
+}
+
+bool AssetPack::find(const std::string& name, const char*& data, std::size_t& size) const
+{
+    auto found = entries.find(name);
+    if (found == entries.end())
+        return false;
+
+    // Two threads may both verify a file the first time, but the result is the same
+    auto& entry = found->second;
+    const char* fileData = archive.data() + entry.offset;
+    if (!entry.verified)
+    {
+        if (checksum(fileData, entry.size) != entry.checksum)
+        {
+            std::cerr << "Corrupt file in asset pack: " << name << "\n";
+            return false;
+        }
+        entry.verified = true;
+    }
+
+    data = fileData;
+    size = entry.size;
+    return true;
+}
+
+std::vector<std::string> AssetPack::getNames() const
+{
+    std::vector<std::string> names;
+    for (auto& entry: entries)
+        names.push_back(entry.first);
+    return names;
+}
+
+bool AssetPack::write(const std::string& filename, const std::vector<File>& files)
+{
+    // Compute where the contents start, after the index
+    std::uint64_t offset = sizeof(MAGIC) + sizeof(std::uint32_t) * 2;
+    for (auto& file: files)
+        offset += sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t) * 2 + file.name.size();
+
+    // Header and index
+    std::string index;
+    index.append(MAGIC, sizeof(MAGIC));
+    writeValue<std::uint32_t>(index, VERSION);
+    writeValue<std::uint32_t>(index, files.size());
+    for (auto& file: files)
+    {
+        writeValue<std::uint32_t>(index, file.name.size());
+        index += file.name;
+        writeValue<std::uint64_t>(index, offset);
+        writeValue<std::uint64_t>(index, file.data.size());
+        writeValue<std::uint32_t>(index, checksum(file.data.data(), file.data.size()));
+        offset += file.data.size();
+    }
+
+    // Contents
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(index.data(), index.size());
+    for (auto& file: files)
+        out.write(file.data.data(), file.data.size());
+    return static_cast<bool>(out);
+}
+
+std::uint32_t AssetPack::checksum(const char* data, std::size_t size)
+{
+    // 32-bit FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "beambatch.h"
+#include "nage/graphics/spriteloader.h"
+
+const char* BeamBatch::textureFilename = "data/images/beam.png";
+
+BeamBatch::BeamBatch()
+{
+    ng::SpriteLoader::preloadTexture(textureFilename);
+    auto& beamTexture = ng::SpriteLoader::getTexture(textureFilename);
+    beamTexture.setSmooth(false);
+    texture = &beamTexture;
+    textureSize = sf::Vector2f(beamTexture.getSize());
+    for (auto& layerVertices: vertices)
+        layerVertices.setPrimitiveType(sf::Quads);
+}
+
+void BeamBatch::clear()
+{
+    for (auto& layerVertices: vertices)
+        layerVertices.clear();
+}
+
+void BeamBatch::add(const Laser::Beam& beam)
+{
+    // The texture is as wide as the beam, and is stretched along the length of the beam
+    sf::Vector2f side(-beam.direction.y, beam.direction.x);
+    side *= textureSize.x / 2;
+    auto& layerVertices = vertices[beam.layer ? 1 : 0];
+    layerVertices.append(sf::Vertex(beam.start + side, sf::Vector2f(0, 0)));
+    layerVertices.append(sf::Vertex(beam.start - side, sf::Vector2f(textureSize.x, 0)));
+    layerVertices.append(sf::Vertex(beam.end - side, textureSize));
+    layerVertices.append(sf::Vertex(beam.end + side, sf::Vector2f(0, textureSize.y)));
+}
+
+void BeamBatch::draw(sf::RenderTarget& target, int layer) const
+{
+    const auto& layerVertices = vertices[layer ? 1 : 0];
+    if (layerVertices.getVertexCount() > 0)
+        target.draw(layerVertices, sf::RenderStates(texture));
+}
@@ -0,0 +1,162 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "bitplane.h"
+#include <algorithm>
+
+namespace
+{
+
+// Positions of the lowest and highest set bits (the word can't be zero)
+unsigned lowestBit(BitPlane::Word word)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(word);
+#else
+    unsigned bit = 0;
+    for (; !(word & 1); word >>= 1)
+        ++bit;
+    return bit;
+#endif
+}
+
+unsigned highestBit(BitPlane::Word word)
+{
+#ifdef __GNUC__
+    return BitPlane::WORD_BITS - 1 - __builtin_clzll(word);
+#else
+    unsigned bit = 0;
+    for (; word >>= 1; )
+        ++bit;
+    return bit;
+#endif
+}
+
+}
+
+BitPlane::BitPlane():
+    planeWidth(0),
+    planeHeight(0),
+    wordsPerRow(0)
+{
+}
+
+void BitPlane::resize(unsigned width, unsigned height, bool preserve)
+{
+    unsigned newWordsPerRow = (width + WORD_BITS - 1) / WORD_BITS;
+    std::vector<Word> newWords(newWordsPerRow * height, 0);
+
+    if (preserve)
+    {
+        // Copy the overlapping rows, and cut off any bits past the new width
+        unsigned rows = std::min(height, planeHeight);
+        unsigned copyWidth = std::min(width, planeWidth);
+        unsigned copyWords = (copyWidth + WORD_BITS - 1) / WORD_BITS;
+        for (unsigned y = 0; y < rows; ++y)
+        {
+            std::copy_n(words.begin() + y * wordsPerRow, copyWords, newWords.begin() + y * newWordsPerRow);
+            if (copyWidth % WORD_BITS)
+                newWords[y * newWordsPerRow + copyWords - 1] &= (Word(1) << (copyWidth % WORD_BITS)) - 1;
+        }
+    }
+
+    planeWidth = width;
+    planeHeight = height;
+    wordsPerRow = newWordsPerRow;
+    words.swap(newWords);
+}
+
+void BitPlane::clear()
+{
+    std::fill(words.begin(), words.end(), 0);
+}
+
+unsigned BitPlane::width() const
+{
+    return planeWidth;
+}
+
+unsigned BitPlane::height() const
+{
+    return planeHeight;
+}
+
+bool BitPlane::any(unsigned y, unsigned startX, unsigned endX) const
+{
+    if (startX > endX)
+        return false;
+
+    const Word* row = getRow(y);
+    unsigned startWord = startX / WORD_BITS;
+    unsigned endWord = endX / WORD_BITS;
+    Word startMask = ~Word(0) << (startX % WORD_BITS);
+    Word endMask = ~Word(0) >> (WORD_BITS - 1 - endX % WORD_BITS);
+
+    if (startWord == endWord)
+        return (row[startWord] & startMask & endMask) != 0;
+
+    // Test the partial words on the ends, and the whole words in between
+    if (row[startWord] & startMask)
+        return true;
+    for (unsigned i = startWord + 1; i < endWord; ++i)
+    {
+        if (row[i])
+            return true;
+    }
+    return (row[endWord] & endMask) != 0;
+}
+
+int BitPlane::findFirst(unsigned y, unsigned startX, unsigned endX) const
+{
+    if (startX > endX)
+        return -1;
+
+    const Word* row = getRow(y);
+    unsigned startWord = startX / WORD_BITS;
+    unsigned endWord = endX / WORD_BITS;
+    Word word = row[startWord] & (~Word(0) << (startX % WORD_BITS));
+    for (unsigned i = startWord; ; word = row[++i])
+    {
+        if (i == endWord)
+            word &= ~Word(0) >> (WORD_BITS - 1 - endX % WORD_BITS);
+        if (word)
+            return (i * WORD_BITS + lowestBit(word));
+        if (i == endWord)
+            return -1;
+    }
+}
+
+int BitPlane::findLast(unsigned y, unsigned startX, unsigned endX) const
+{
+    if (startX > endX)
+        return -1;
+
+    const Word* row = getRow(y);
+    unsigned startWord = startX / WORD_BITS;
+    unsigned endWord = endX / WORD_BITS;
+    Word word = row[endWord] & (~Word(0) >> (WORD_BITS - 1 - endX % WORD_BITS));
+    for (unsigned i = endWord; ; word = row[--i])
+    {
+        if (i == startWord)
+            word &= ~Word(0) << (startX % WORD_BITS);
+        if (word)
+            return (i * WORD_BITS + highestBit(word));
+        if (i == startWord)
+            return -1;
+    }
+}
+
+BitPlane::Word* BitPlane::getRow(unsigned y)
+{
+    return &words[y * wordsPerRow];
+}
+
+const BitPlane::Word* BitPlane::getRow(unsigned y) const
+{
+    return &words[y * wordsPerRow];
+}
+
+unsigned BitPlane::getWordsPerRow() const
+{
+    return wordsPerRow;
+}
@@ -0,0 +1,116 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "compositelayer.h"
+#include "tilemapdata.h"
+#include "nage/graphics/tilemap.h"
+#include "magicwindow.h"
+#include <cmath>
+#include <algorithm>
+
+CompositeLayer::CompositeLayer(TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow):
+    tileMapData(tileMapData),
+    tileMap(tileMap),
+    magicWindow(magicWindow),
+    width(0),
+    height(0),
+    lastVisible(false)
+{
+}
+
+void CompositeLayer::reset()
+{
+    // Start with only the real world
+    width = tileMapData.width();
+    height = tileMapData.height();
+    layers.assign(width * height, 0);
+
+    // Overlay the current window
+    lastBounds = magicWindow.getBounds();
+    lastVisible = magicWindow.isVisible();
+    lastFootprint = getFootprint();
+    windowArea = sf::IntRect();
+    fill(lastFootprint, true);
+}
+
+void CompositeLayer::update()
+{
+    auto bounds = magicWindow.getBounds();
+    bool visible = magicWindow.isVisible();
+    if (visible != lastVisible || (visible && bounds != lastBounds))
+    {
+        // Restore the real world under the old window, and overlay the new window
+        auto footprint = getFootprint();
+        fill(lastFootprint, false);
+        windowArea = sf::IntRect();
+        fill(footprint, true);
+        lastFootprint = footprint;
+        lastBounds = bounds;
+        lastVisible = visible;
+    }
+}
+
+int CompositeLayer::getLayer(unsigned x, unsigned y) const
+{
+    return ((x < width && y < height) ? layers[y * width + x] : 0);
+}
+
+const sf::IntRect& CompositeLayer::getWindowArea() const
+{
+    return windowArea;
+}
+
+CompositeLayer::Footprint CompositeLayer::getFootprint() const
+{
+    Footprint footprint;
+    if (!magicWindow.isVisible() || width == 0 || height == 0)
+        return footprint;
+
+    // Get the range of tiles the window could contain the center points of
+    auto bounds = magicWindow.getBounds();
+    const auto& tileSize = tileMap.getTileSize();
+    int left = std::floor(bounds.left / tileSize.x) - 1;
+    int top = std::floor(bounds.top / tileSize.y) - 1;
+    int right = std::floor((bounds.left + bounds.width) / tileSize.x) + 1;
+    int bottom = std::floor((bounds.top + bounds.height) / tileSize.y) + 1;
+
+    // Make sure this is within bounds
+    if (right < 0 || bottom < 0 || left >= static_cast<int>(width) || top >= static_cast<int>(height))
+        return footprint;
+    footprint.left = std::max(left, 0);
+    footprint.top = std::max(top, 0);
+    footprint.right = std::min(right, static_cast<int>(width) - 1);
+    footprint.bottom = std::min(bottom, static_cast<int>(height) - 1);
+    footprint.empty = false;
+    return footprint;
+}
+
+void CompositeLayer::fill(const Footprint& footprint, bool useWindow)
+{
+    if (footprint.empty)
+        return;
+
+    // The tiles in the window always form a rectangle, so only the corners need to be kept
+    int left = width;
+    int top = height;
+    int right = -1;
+    int bottom = -1;
+    for (unsigned y = footprint.top; y <= footprint.bottom; ++y)
+    {
+        for (unsigned x = footprint.left; x <= footprint.right; ++x)
+        {
+            // Use the exact same test as the window itself, so nothing changes at the edges
+            bool inWindow = (useWindow && magicWindow.isWithin(tileMap.getCenterPoint<unsigned>(x, y)));
+            layers[y * width + x] = (inWindow ? 1 : 0);
+            if (inWindow)
+            {
+                left = std::min<int>(left, x);
+                top = std::min<int>(top, y);
+                right = std::max<int>(right, x);
+                bottom = std::max<int>(bottom, y);
+            }
+        }
+    }
+    if (right >= 0)
+        windowArea = sf::IntRect(left, top, right - left + 1, bottom - top + 1);
+}
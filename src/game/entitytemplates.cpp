@@ -0,0 +1,56 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "entitytemplates.h"
+#include "es/serialize.h"
+
+es::Entity EntityTemplates::create(es::World& world, const std::string& prototype, const std::string& name,
+    const std::vector<std::string>& components)
+{
+    auto& makeFuncs = getMakeFuncs();
+
+    // Copy the typed components of the prototype
+    auto ent = world.copy(prototype, name);
+
+    for (auto& str: components)
+    {
+        std::string compName;
+        es::unpack(str, compName);
+        auto found = makeFuncs.find(compName);
+        if (found == makeFuncs.end())
+        {
+            // Unknown component type, so this can only be parsed
+            ent << str;
+            continue;
+        }
+
+        // Use the typed component if this string was already parsed more than once
+        std::string key = prototype + '\n' + str;
+        auto cached = parsed.find(key);
+        if (cached != parsed.end() && cached->second)
+        {
+            cached->second->apply(ent);
+            continue;
+        }
+
+        // Parse the component on top of the prototype, and only keep it if the string repeats
+        ent << str;
+        if (cached == parsed.end())
+            parsed.emplace(std::move(key), nullptr);
+        else
+            cached->second = found->second(ent);
+    }
+
+    return ent;
+}
+
+void EntityTemplates::clear()
+{
+    parsed.clear();
+}
+
+EntityTemplates::MakeFuncMap& EntityTemplates::getMakeFuncs()
+{
+    static MakeFuncMap makeFuncs;
+    return makeFuncs;
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "fixedtimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float tickRate, unsigned maxTicksPerFrame):
+    tickTime(1.0f / 60.0f),
+    maxTicks(1),
+    accumulator(0)
+{
+    setTickRate(tickRate);
+    setMaxTicksPerFrame(maxTicksPerFrame);
+}
+
+void FixedTimestep::setTickRate(float tickRate)
+{
+    if (tickRate > 0)
+        tickTime = 1.0f / tickRate;
+}
+
+void FixedTimestep::setMaxTicksPerFrame(unsigned maxTicks)
+{
+    this->maxTicks = std::max(maxTicks, 1u);
+}
+
+float FixedTimestep::getTickTime() const
+{
+    return tickTime;
+}
+
+unsigned FixedTimestep::addFrameTime(float dt)
+{
+    accumulator += std::max(dt, 0.0f);
+    unsigned ticks = accumulator / tickTime;
+    if (ticks > maxTicks)
+    {
+        ticks = maxTicks;
+        accumulator = tickTime * ticks;
+    }
+    accumulator -= tickTime * ticks;
+    return ticks;
+}
+
+float FixedTimestep::getAlpha() const
+{
+    return std::min(accumulator / tickTime, 1.0f);
+}
+
+void FixedTimestep::reset()
+{
+    accumulator = 0;
+}
@@ -0,0 +1,35 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "gamecomponents.h"
+#include "components.h"
+#include "movingcomponent.h"
+#include "lasercomponent.h"
+#include "es/entityprototypeloader.h"
+#include "entitytemplates.h"
+
+namespace
+{
+
+template <typename... Comps>
+struct ComponentList {};
+
+// Every component type used in levels
+using GameComponents = ComponentList<Position, Velocity, Size, AABB, Sprite, AnimSprite, Jumpable, ObjectState,
+    Movable, Carrier, Gravity, State, TileGroup, TilePosition, Rotation, Switch, InitialPosition, Prototype,
+    CameraUpdater, AltWorld, DrawOnTop, Carryable, AboveWindow, Rigid, BlocksLaser, ExcludeFromLevel, Moving, Laser>;
+
+template <typename... Comps>
+void registerComponents(ComponentList<Comps...>)
+{
+    es::registerComponents<Comps...>();
+    EntityTemplates::registerComponents<Comps...>();
+}
+
+}
+
+bool setupGameComponents()
+{
+    registerComponents(GameComponents());
+    return es::loadPrototypes("data/config/entities.cfg");
+}
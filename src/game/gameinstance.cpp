@@ -24,7 +24,10 @@ GameInstance::GameInstance(sf::RenderWindow& window, GameSaveHandler& gameSave):
     tileMapChanger(tileMapData, tileMap),
     level(tileMapData, tileMap, tileMapChanger, world, magicWindow),
     levelLoader(level, gameSave, "data/levels/"),
-    magicWindow(actions)
+    magicWindow(actions),
+    compositeLayer(tileMapData, tileMap, magicWindow),
+    levelSnapshot(tileMapData, tileMapChanger, world, magicWindow),
+    positionHistory(world)
 {
     std::cout << "Initializing GameInstance...\n";
 
@@ -35,16 +38,16 @@ GameInstance::GameInstance(sf::RenderWindow& window, GameSaveHandler& gameSave):
     systems.add<InputSystem>(window);
     systems.add<MovingSystem>(world);
     systems.add<PlayerSystem>(world, actions, level);
-    systems.add<PhysicsSystem>(world, tileMapData, tileMap, magicWindow, level);
+    systems.add<PhysicsSystem>(world, tileMapData, tileMap, magicWindow, compositeLayer, level);
     systems.add<CarrySystem>(world, magicWindow);
-    systems.add<SpriteSystem>(world);
+    systems.add<SpriteSystem>(world, positionHistory);
     systems.add<CameraSystem>(camera, tileMap);
     systems.add<TileSystem>(world, tileMapData);
     systems.add<SwitchSystem>(tileMapData, tileMapChanger, world);
     systems.add<ObjectSwitchSystem>(level, world);
     systems.add<TileGroupSystem>(tileMapChanger, world);
-    systems.add<LaserSystem>(world, tileMapData, tileMap, magicWindow);
-    systems.add<RenderSystem>(world, tileMap, smoothTileMap, window, camera, magicWindow, level, gameSave);
+    systems.add<LaserSystem>(world, tileMapData, tileMap, magicWindow, compositeLayer, beamBatch);
+    systems.add<RenderSystem>(world, tileMap, smoothTileMap, window, camera, magicWindow, beamBatch, level, gameSave);
     systems.add<TileSmoothingSystem>(world, tileMapData, smoothTileMap);
 
     // Load the tiles
@@ -15,6 +15,12 @@ const cfg::File::ConfigMap GameResources::defaultOptions = {
         {"windowWidth", cfg::makeOption(defaultResolution.x, minResolution.x)},
         {"windowHeight", cfg::makeOption(defaultResolution.y, minResolution.y)}
         }
+    },
+    {"Simulation",{
+        {"tickRate", cfg::makeOption(60, 1)},
+        {"maxTicksPerFrame", cfg::makeOption(8, 1)},
+        {"physicsThreads", cfg::makeOption(0, 0)}
+        }
     }
 };
 
@@ -2,26 +2,26 @@
 // This code is licensed under GPLv3, see LICENSE.txt for details.
 
 #include "level.h"
-#include <sstream>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include "es/events.h"
 #include "gameevents.h"
 #include "tilemapdata.h"
 #include "nage/graphics/tilemap.h"
 #include "tilemapchanger.h"
 #include "components.h"
-#include "logicaltiles.h"
 #include "magicwindow.h"
+#include "entitytemplates.h"
+#include "virtualfilesystem.h"
 
-const cfg::File::ConfigMap Level::defaultOptions = {
-    {"", {
-        {"width", cfg::makeOption(32, 0)},
-        {"height", cfg::makeOption(12, 0)},
-        {"version", cfg::makeOption(1, 0)},
-        {"name", cfg::makeOption("Untitled")}
-        }
-    }
-};
+namespace
+{
+
+// Every world shares the prototype world and the sprite texture cache, so entities are created one level at a time
+std::mutex sharedEntityMutex;
+
+}
 
 Level::Level(TileMapData& tileMapData, ng::TileMap& tileMap, TileMapChanger& tileMapChanger, es::World& world, MagicWindow& magicWindow):
     tileMapData(tileMapData),
@@ -34,8 +34,8 @@ Level::Level(TileMapData& tileMapData, ng::TileMap& tileMap, TileMapChanger& til
 
 bool Level::loadFromFile(const std::string& filename)
 {
-    cfg::File config(filename, defaultOptions);
-    bool status = config.getStatus();
+    cfg::File config(LevelData::defaultOptions);
+    bool status = VirtualFileSystem::loadConfig(filename, config);
     if (status)
     {
         load(config);
@@ -46,9 +46,23 @@ bool Level::loadFromFile(const std::string& filename)
     return status;
 }
 
+bool Level::loadFromBinaryFile(const std::string& filename)
+{
+    LevelData data;
+    bool status = data.loadFromBinaryFile(filename);
+    if (status)
+    {
+        load(data);
+        std::cout << "Loaded binary level file: " << filename << "\n";
+    }
+    else
+        std::cerr << "Error loading binary level file: " << filename << "\n";
+    return status;
+}
+
 void Level::loadFromString(const std::string& data)
 {
-    cfg::File config(defaultOptions);
+    cfg::File config(LevelData::defaultOptions);
     config.loadFromString(data);
     load(config);
     std::cout << "Loaded new level from memory.\n";
@@ -57,7 +71,7 @@ void Level::loadFromString(const std::string& data)
 bool Level::saveToFile(const std::string& filename) const
 {
     // Save everything to a level file
-    cfg::File config(defaultOptions);
+    cfg::File config(LevelData::defaultOptions);
     save(config);
 
     // Write the level file
@@ -71,35 +85,39 @@ bool Level::saveToFile(const std::string& filename) const
 
 void Level::saveToString(std::string& data) const
 {
-    cfg::File config(defaultOptions);
+    cfg::File config(LevelData::defaultOptions);
     save(config);
     config.writeToString(data);
     std::cout << "Saved level to memory.\n";
 }
 
-void Level::load(cfg::File& config)
+void Level::load(const LevelData& data)
 {
-    // Load everything from the config file
-    name = config("name");
-    loadTileMap(config);
-    loadEntities(config);
+    // Load everything from the level data (component strings from the last level won't be used again)
+    templates.clear();
+    name = data.name;
+    loadTileMap(data);
+    loadEntities(data.entities, world, templates);
+    clearSaveCache();
 
     // Reset window
     magicWindow.show(false);
     magicWindow.setSize();
 }
 
-void Level::save(cfg::File& config) const
+void Level::save(LevelData& data) const
 {
-    // Save everything to a level file in memory
-    saveTileMap(config);
-    saveEntities(config);
+    // Save everything to the level data
+    data.name = name;
+    saveTileMap(data);
+    saveEntities(data);
 }
 
 void Level::clear()
 {
     tileMapChanger.clear();
     world.clear();
+    clearSaveCache();
 }
 
 const std::string& Level::getName() const
@@ -108,187 +126,158 @@ const std::string& Level::getName() const
 }
 
 void Level::loadEntities(cfg::File::Section& section, es::World& world)
+{
+    std::vector<LevelData::Entity> entities;
+    LevelData::loadEntities(section, entities);
+    EntityTemplates templates;
+    loadEntities(entities, world, templates);
+}
+
+void Level::loadEntities(const std::vector<LevelData::Entity>& entities, es::World& world, EntityTemplates& templates)
 {
     world.clear();
 
-    // Create world from level file
-    for (auto& option: section)
+    // Create world from level data
+    std::lock_guard<std::mutex> lock(sharedEntityMutex);
+    for (auto& entity: entities)
     {
-        // Extract entity name and type
-        auto names = strlib::split(option.first, ":");
-        names.resize(2);
-
-        // Create an entity (with the type if specified)
-        auto ent = world.copy(names.back(), names.front());
-
-        // Update all specified components
-        for (auto& compOption: option.second)
-            ent << compOption.toString();
+        // Create an entity (with the type if specified), and update all specified components
+        auto ent = templates.create(world, entity.prototype, entity.name, entity.components);
 
         // Store prototype name
-        if (!names.back().empty())
-            ent.assign<Prototype>(names.back());
+        if (!entity.prototype.empty())
+            ent.assign<Prototype>(entity.prototype);
     }
 }
 
-void Level::loadLogicalLayer(cfg::File& config, int layer)
+void Level::load(cfg::File& config)
 {
-    int y = 0;
-    for (auto& tiles: config("logical"))
-    {
-        int x = 0;
-        auto values = strlib::split<int>(tiles, " ");
-        for (int logicalId: values)
-        {
-            if (tileMap.inBounds(x, y))
-            {
-                tileMapData(x, y).logicalId = logicalId;
-
-                // Populate the logical to tile ID map
-                if (logicalId != Tiles::None && logicalId != Tiles::Normal)
-                    tileMapData[logicalId].push_back(tileMapData.getId(x, y));
-            }
-            ++x;
-        }
-        ++y;
-    }
+    LevelData data;
+    data.loadFromConfig(config);
+    load(data);
 }
 
-void Level::loadVisualLayer(cfg::File& config, int layer)
+void Level::save(cfg::File& config) const
 {
-    int y = 0;
-    for (auto& tiles: config("visual"))
-    {
-        int x = 0;
-        auto values = strlib::split<int>(tiles, " ");
-        for (int visualId: values)
-        {
-            if (tileMap.inBounds(x, y))
-            {
-                // Update the visual layer and graphical tile map
-                tileMapData(x, y).visualId = visualId;
-                tileMap.set(x, y, visualId);
-            }
-            ++x;
-        }
-        ++y;
-    }
+    LevelData data;
+    save(data);
+    data.saveToConfig(config);
 }
 
-void Level::loadTileMap(cfg::File& config)
+void Level::loadTileMap(const LevelData& data)
 {
     // Resize tile maps
-    unsigned width = config("width").toInt();
-    unsigned height = config("height").toInt();
-    tileMap.resize(width, height);
-    tileMapData.resize(width, height);
-    tileMapData.clearTileIds();
+    tileMap.resize(data.width, data.height);
+    tileMapData.resize(data.width, data.height);
 
     // Load layer data
-    for (auto& section: config)
+    for (int layer = 0; layer <= 1; ++layer)
     {
-        // Parse the layer ID from the section name
-        int currentLayer = strlib::fromString<int>(section.first, -1);
-
-        if (currentLayer == 0 || currentLayer == 1)
+        tileMap.useLayer(layer);
+        auto& logicalIds = data.logicalIds[layer];
+        auto& visualIds = data.visualIds[layer];
+        for (unsigned y = 0; y < data.height; ++y)
         {
-            tileMap.useLayer(currentLayer);
-            tileMapData.useLayer(currentLayer);
-            config.useSection(section.first);
-
-            loadLogicalLayer(config, currentLayer);
-            loadVisualLayer(config, currentLayer);
+            for (unsigned x = 0; x < data.width; ++x)
+            {
+                // Update the logical/visual layers and graphical tile map
+                auto tile = tileMapData(layer, x, y);
+                tile.logicalId = logicalIds[y * data.width + x];
+                tile.visualId = visualIds[y * data.width + x];
+                tileMap.set(x, y, visualIds[y * data.width + x]);
+            }
         }
     }
 
     // Derive the remaining layer data (states and collision layers)
     tileMapData.deriveTiles();
 
+    // Populate the logical to tile ID lists
+    tileMapData.buildTileIds();
+
     // Use the real world as the current layer
     tileMap.useLayer(0);
 }
 
-void Level::loadEntities(cfg::File& config)
-{
-    loadEntities(config.getSection("Entities"), world);
-}
-
-void Level::saveTileMap(cfg::File& config) const
+void Level::saveTileMap(LevelData& data) const
 {
-    // Save size
-    unsigned width = tileMapData.width();
-    unsigned height = tileMapData.height();
-    config.useSection();
-    config("width") = width;
-    config("height") = height;
-
-    // Real/Alternate: logical, visual
-    unsigned layer = 0;
-    for (const auto& section: {"0: Real", "1: Alternate"})
+    data.resize(tileMapData.width(), tileMapData.height());
+    for (int layer = 0; layer <= 1; ++layer)
     {
-        tileMapData.useLayer(layer);
-        config.useSection(section);
-        for (unsigned y = 0; y < tileMapData.height(); ++y)
+        for (unsigned y = 0; y < data.height; ++y)
         {
-            std::ostringstream logicalStream;
-            std::ostringstream visualStream;
-            for (unsigned x = 0; x < width; ++x)
+            for (unsigned x = 0; x < data.width; ++x)
             {
-                auto& tile = tileMapData(x, y);
-                logicalStream << tile.logicalId;
-                visualStream << tile.visualId;
-                if (x < width - 1)
-                {
-                    logicalStream << " ";
-                    visualStream << " ";
-                }
+                data.logicalIds[layer][y * data.width + x] = tileMapData.getLogicalId(layer, x, y);
+                data.visualIds[layer][y * data.width + x] = tileMapData.getVisualId(layer, x, y);
             }
-            config("logical") << logicalStream.str();
-            config("visual") << visualStream.str();
         }
-        ++layer;
     }
 }
 
-void Level::saveEntities(cfg::File& config) const
+void Level::saveEntities(LevelData& data) const
 {
     // TODO: Save with the prototype name, and only include different components
-    config.useSection("Entities");
+    data.entities.clear();
     for (const auto& ent: world.query())
     {
         if (!ent.has<ExcludeFromLevel>())
         {
-            // Serialize all of the components and store them in an options array
+            // Serialize all of the components
             auto comps = ent.serialize();
             std::sort(comps.begin(), comps.end());
 
-            // Get prototype name if it exists, as well as the option name
-            std::string optionName = ent.getName();
-            std::string prototypeName;
-            auto prototype = ent.get<Prototype>();
-            if (prototype)
+            // Reuse the entity from the last save if none of its components changed (only named entities are kept)
+            std::string entityName = ent.getName();
+            auto found = savedEntities.find(entityName);
+            if (!entityName.empty() && found != savedEntities.end() && found->second.comps == comps)
+                data.entities.push_back(found->second.entity);
+            else
             {
-                prototypeName = prototype->entityName;
-                if (!prototypeName.empty())
-                    optionName += ':' + prototypeName;
+                data.entities.emplace_back();
+                saveEntity(ent, comps, data.entities.back());
+                if (!entityName.empty())
+                    savedEntities[entityName] = SavedEntity{std::move(comps), data.entities.back()};
             }
+        }
+    }
+}
 
-            // Get the option array being written to
-            auto& option = config(optionName);
+void Level::saveEntity(const es::Entity& ent, const std::vector<std::string>& comps, LevelData::Entity& entity) const
+{
+    // Get prototype name if it exists
+    entity.name = ent.getName();
+    auto prototype = ent.get<Prototype>();
+    if (prototype)
+        entity.prototype = prototype->entityName;
+
+    // Save the components to the entity
+    for (const auto& str: comps)
+    {
+        std::string compName;
+        es::unpack(str, compName);
 
-            // Get the prototype entity
-            auto prototypeEnt = es::World::prototypes.get(prototypeName);
+        // Only save components different from the components in the prototype
+        if (compName != "Prototype" && getPrototypeComponent(entity.prototype, compName) != str)
+            entity.components.push_back(str);
+    }
+}
 
-            // Save the components to the option array
-            for (const auto& str: comps)
-            {
-                std::string compName;
-                es::unpack(str, compName);
+void Level::clearSaveCache()
+{
+    savedEntities.clear();
+    prototypeComponents.clear();
+}
 
-                // Only save components different from the components in the prototype
-                if (compName != "Prototype" && prototypeEnt.serialize(compName) != str)
-                    option << str;
-            }
-        }
+const std::string& Level::getPrototypeComponent(const std::string& prototype, const std::string& compName) const
+{
+    std::string key = prototype + '\n' + compName;
+    auto found = prototypeComponents.find(key);
+    if (found == prototypeComponents.end())
+    {
+        std::lock_guard<std::mutex> lock(sharedEntityMutex);
+        auto prototypeEnt = es::World::prototypes.get(prototype);
+        found = prototypeComponents.emplace(key, prototypeEnt.serialize(compName)).first;
     }
+    return found->second;
 }
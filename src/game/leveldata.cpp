@@ -0,0 +1,327 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "leveldata.h"
+#include "mappedfile.h"
+#include "tilegrid.h"
+#include "virtualfilesystem.h"
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+const cfg::File::ConfigMap LevelData::defaultOptions = {
+    {"", {
+        {"width", cfg::makeOption(32, 0)},
+        {"height", cfg::makeOption(12, 0)},
+        {"version", cfg::makeOption(1, 0)},
+        {"name", cfg::makeOption("Untitled")}
+        }
+    }
+};
+
+const char LevelData::BINARY_MAGIC[4] = {'M', 'V', 'L', 'B'};
+const unsigned LevelData::BINARY_VERSION = 1;
+
+namespace
+{
+
+const char* layerSections[] = {"0: Real", "1: Alternate"};
+
+// Reads values from a binary buffer, and keeps track of whether it went past the end
+class BinaryReader
+{
+    public:
+        BinaryReader(const char* data, std::size_t size):
+            data(data),
+            remaining(size),
+            valid(true)
+        {
+        }
+
+        bool read(void* dest, std::size_t count)
+        {
+            if (!valid || count > remaining)
+            {
+                valid = false;
+                return false;
+            }
+            if (count)
+                std::memcpy(dest, data, count);
+            data += count;
+            remaining -= count;
+            return true;
+        }
+
+        std::uint32_t readInt()
+        {
+            std::uint32_t value = 0;
+            read(&value, sizeof(value));
+            return value;
+        }
+
+        std::string readString()
+        {
+            std::uint32_t length = readInt();
+            if (!valid || length > remaining)
+            {
+                valid = false;
+                return std::string();
+            }
+            std::string str(data, length);
+            data += length;
+            remaining -= length;
+            return str;
+        }
+
+        bool isValid() const
+        {
+            return valid;
+        }
+
+    private:
+        const char* data;
+        std::size_t remaining;
+        bool valid;
+};
+
+// Parses the rows of one layer, and reports any rows that don't match the size of the level
+template <typename T>
+bool readRows(cfg::Option& rows, T* values, unsigned width, unsigned height, const std::string& where)
+{
+    bool valid = true;
+    unsigned y = 0;
+    for (auto& tiles: rows)
+    {
+        if (y < height)
+        {
+            unsigned invalid = 0;
+            unsigned count = TileGrid::readRow(tiles.toString(), values + y * width, width, invalid);
+            if (count != width || invalid > 0)
+            {
+                std::cerr << where << " row " << y << ": " << count << " IDs (expected " << width << "), "
+                    << invalid << " invalid\n";
+                valid = false;
+            }
+        }
+        ++y;
+    }
+    if (y != height)
+    {
+        std::cerr << where << ": " << y << " rows (expected " << height << ")\n";
+        valid = false;
+    }
+    return valid;
+}
+
+void writeInt(std::string& data, std::uint32_t value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::string& data, const std::string& str)
+{
+    writeInt(data, str.size());
+    data += str;
+}
+
+}
+
+bool LevelData::Entity::operator==(const Entity& other) const
+{
+    return (name == other.name && prototype == other.prototype && components == other.components);
+}
+
+void LevelData::resize(unsigned newWidth, unsigned newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        logicalIds[layer].assign(width * height, 0);
+        visualIds[layer].assign(width * height, 0);
+    }
+}
+
+bool LevelData::loadFromConfig(cfg::File& config)
+{
+    config.useSection();
+    name = config("name").toString();
+    resize(config("width").toInt(), config("height").toInt());
+
+    // Load layer data
+    bool valid = true;
+    for (auto& section: config)
+    {
+        // Parse the layer ID from the section name
+        int layer = strlib::fromString<int>(section.first, -1);
+        if (layer == 0 || layer == 1)
+        {
+            config.useSection(section.first);
+            std::string where = "Level \"" + name + "\", " + section.first;
+            valid &= readRows(config("logical"), logicalIds[layer].data(), width, height, where + ", logical");
+            valid &= readRows(config("visual"), visualIds[layer].data(), width, height, where + ", visual");
+        }
+    }
+
+    loadEntities(config.getSection("Entities"), entities);
+    return valid;
+}
+
+void LevelData::saveToConfig(cfg::File& config) const
+{
+    // Save size
+    config.useSection();
+    config("name") = name;
+    config("width") = width;
+    config("height") = height;
+
+    // Real/Alternate: logical, visual (reusing one buffer for every row)
+    std::string buffer;
+    buffer.reserve(width * 6);
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        config.useSection(layerSections[layer]);
+        auto& logical = config("logical");
+        auto& visual = config("visual");
+        for (unsigned y = 0; y < height; ++y)
+        {
+            TileGrid::writeRow(buffer, logicalIds[layer].data() + y * width, width);
+            logical << buffer;
+            TileGrid::writeRow(buffer, visualIds[layer].data() + y * width, width);
+            visual << buffer;
+        }
+    }
+
+    // Entities, with the prototype name after the entity name
+    config.useSection("Entities");
+    for (auto& entity: entities)
+    {
+        std::string optionName = entity.name;
+        if (!entity.prototype.empty())
+            optionName += ':' + entity.prototype;
+        auto& option = config(optionName);
+        for (auto& component: entity.components)
+            option << component;
+    }
+}
+
+void LevelData::loadEntities(cfg::File::Section& section, std::vector<Entity>& entities)
+{
+    entities.clear();
+    for (auto& option: section)
+    {
+        // Extract entity name and type
+        auto names = strlib::split(option.first, ":");
+        names.resize(2);
+
+        entities.emplace_back();
+        auto& entity = entities.back();
+        entity.name = names.front();
+        entity.prototype = names.back();
+        for (auto& compOption: option.second)
+            entity.components.push_back(compOption.toString());
+    }
+}
+
+bool LevelData::loadFromBinary(const char* data, std::size_t size)
+{
+    BinaryReader reader(data, size);
+
+    // Check the header
+    char magic[4] = {};
+    reader.read(magic, sizeof(magic));
+    if (!reader.isValid() || !std::equal(magic, magic + 4, BINARY_MAGIC) || reader.readInt() != BINARY_VERSION)
+        return false;
+    unsigned newWidth = reader.readInt();
+    unsigned newHeight = reader.readInt();
+    unsigned entityCount = reader.readInt();
+    name = reader.readString();
+
+    // Make sure the tiles fit before allocating anything
+    std::size_t tileCount = std::size_t(newWidth) * newHeight;
+    if (!reader.isValid() || tileCount * 3 * 2 > size)
+        return false;
+
+    // Copy the tile layers directly
+    resize(newWidth, newHeight);
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        reader.read(logicalIds[layer].data(), tileCount * sizeof(std::uint8_t));
+        reader.read(visualIds[layer].data(), tileCount * sizeof(std::uint16_t));
+    }
+
+    // Read the entities
+    entities.clear();
+    for (unsigned i = 0; i < entityCount && reader.isValid(); ++i)
+    {
+        entities.emplace_back();
+        auto& entity = entities.back();
+        entity.name = reader.readString();
+        entity.prototype = reader.readString();
+        unsigned componentCount = reader.readInt();
+        for (unsigned j = 0; j < componentCount && reader.isValid(); ++j)
+            entity.components.push_back(reader.readString());
+    }
+
+    return reader.isValid();
+}
+
+bool LevelData::loadFromBinaryFile(const std::string& filename)
+{
+    const char* data = nullptr;
+    std::size_t size = 0;
+    MappedFile looseFile;
+    return (VirtualFileSystem::getView(filename, data, size, looseFile) && loadFromBinary(data, size));
+}
+
+void LevelData::saveToBinary(std::string& data) const
+{
+    data.clear();
+
+    // Header
+    data.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    writeInt(data, BINARY_VERSION);
+    writeInt(data, width);
+    writeInt(data, height);
+    writeInt(data, entities.size());
+    writeString(data, name);
+
+    // Tile layers
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        data.append(reinterpret_cast<const char*>(logicalIds[layer].data()), logicalIds[layer].size() * sizeof(std::uint8_t));
+        data.append(reinterpret_cast<const char*>(visualIds[layer].data()), visualIds[layer].size() * sizeof(std::uint16_t));
+    }
+
+    // Entities
+    for (auto& entity: entities)
+    {
+        writeString(data, entity.name);
+        writeString(data, entity.prototype);
+        writeInt(data, entity.components.size());
+        for (auto& component: entity.components)
+            writeString(data, component);
+    }
+}
+
+bool LevelData::saveToBinaryFile(const std::string& filename) const
+{
+    std::string data;
+    saveToBinary(data);
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    return (file && file.write(data.data(), data.size()));
+}
+
+bool LevelData::operator==(const LevelData& other) const
+{
+    return (name == other.name && width == other.width && height == other.height &&
+        logicalIds[0] == other.logicalIds[0] && logicalIds[1] == other.logicalIds[1] &&
+        visualIds[0] == other.visualIds[0] && visualIds[1] == other.visualIds[1] &&
+        entities == other.entities);
+}
+
+bool LevelData::operator!=(const LevelData& other) const
+{
+    return !(*this == other);
+}
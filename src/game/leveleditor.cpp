@@ -17,6 +17,7 @@
 #include "lasersystem.h"
 #include "spritesystem.h"
 #include "tilesmoothingsystem.h"
+#include "virtualfilesystem.h"
 #include <iostream>
 
 const sf::Color LevelEditor::borderColors[] = {sf::Color::Blue, sf::Color::Green};
@@ -231,8 +232,8 @@ void LevelEditor::prevLevel()
 
 void LevelEditor::loadConfig(const std::string& filename)
 {
-    cfg::File config(filename);
-    if (!config)
+    cfg::File config;
+    if (!VirtualFileSystem::loadConfig(filename, config))
         return;
 
     // Load controls and setup actions
@@ -337,7 +338,7 @@ void LevelEditor::paintTile(int tileId, int visualId)
         return;
 
     // Set the tile and update the graphical tile map
-    auto& tile = gameInstance.tileMapData(tileId);
+    auto tile = gameInstance.tileMapData(tileId);
     tile = visualTiles[visualId];
 
     // If it's a platform tile, erase it
@@ -359,7 +360,7 @@ void LevelEditor::paintTile(int tileId, int visualId)
         tileIds.erase(tileId);
 
     // Remove the object at this tile ID
-    world.destroy(std::to_string(tileId));
+    removeObject(tileId);
 }
 
 bool LevelEditor::getLocation()
@@ -6,12 +6,17 @@
 #include "es/events.h"
 #include "gameevents.h"
 #include "gamesavehandler.h"
+#include "virtualfilesystem.h"
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
 
 LevelLoader::LevelLoader(Level& level, GameSaveHandler& gameSave, const std::string& levelDir):
     level(level),
     gameSave(gameSave),
-    levelDir(levelDir)
+    levelDir(levelDir),
+    prefetchedLevelId(-1)
 {
 }
 
@@ -43,13 +48,24 @@ LevelLoader::Status LevelLoader::load(int levelId)
 
     if (levelData.empty())
     {
-        // Build the level filename and load it
+        // Use the prefetched level if there is one, otherwise read the level file now
         auto filename = getLevelFilename(levelId);
-        if (level.loadFromFile(filename))
+        LevelData data;
+        bool loaded = takePrefetched(levelId, data);
+        if (!loaded)
+            loaded = readLevel(filename, getBinaryLevelFilename(levelId), data);
+        if (loaded)
         {
+            level.load(data);
             gameSave.setCurrentLevel(levelId);
             status = Status::Success;
+            std::cout << "Loaded level file: " << filename << "\n";
+
+            // Start reading the next level while this one is being played
+            prefetch(levelId + 1);
         }
+        else
+            std::cerr << "Error loading level file: " << filename << "\n";
     }
     else
     {
@@ -97,6 +113,69 @@ std::string LevelLoader::getLevelFilename(int levelId) const
     return (levelDir + std::to_string(levelId) + ".cfg");
 }
 
+std::string LevelLoader::getBinaryLevelFilename(int levelId) const
+{
+    return (levelDir + std::to_string(levelId) + ".bin");
+}
+
+void LevelLoader::prefetch(int levelId)
+{
+    if (levelId > GameSaveHandler::TOTAL_LEVELS || (prefetched.valid() && prefetchedLevelId == levelId))
+        return;
+
+    // Keep unused prefetches alive until they finish, since destroying a running one would wait for it
+    abandoned.erase(std::remove_if(abandoned.begin(), abandoned.end(), [](const std::future<PrefetchResult>& future)
+        { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }), abandoned.end());
+    if (prefetched.valid())
+        abandoned.push_back(std::move(prefetched));
+
+    auto filename = getLevelFilename(levelId);
+    auto binaryFilename = getBinaryLevelFilename(levelId);
+    prefetchedLevelId = levelId;
+    prefetched = std::async(std::launch::async, [filename, binaryFilename]
+    {
+        PrefetchResult result;
+        result.loaded = readLevel(filename, binaryFilename, result.data);
+        return result;
+    });
+}
+
+bool LevelLoader::takePrefetched(int levelId, LevelData& data)
+{
+    if (!prefetched.valid() || prefetchedLevelId != levelId)
+        return false;
+
+    // Wait for the prefetch if it is still running, since reading the file again would take longer
+    auto result = prefetched.get();
+    if (result.loaded)
+        data = std::move(result.data);
+    return result.loaded;
+}
+
+bool LevelLoader::readLevel(const std::string& filename, const std::string& binaryFilename, LevelData& data)
+{
+    // Use the binary version if it is up to date, or if there is no loose text version to compare with
+    struct stat info;
+    bool binaryUsable = (isNewerOrSame(binaryFilename, filename) || stat(filename.c_str(), &info) != 0);
+    if (binaryUsable && data.loadFromBinaryFile(binaryFilename))
+        return true;
+
+    cfg::File config(LevelData::defaultOptions);
+    if (!VirtualFileSystem::loadConfig(filename, config))
+        return false;
+    data.loadFromConfig(config);
+    return true;
+}
+
+bool LevelLoader::isNewerOrSame(const std::string& filename, const std::string& otherFilename)
+{
+    struct stat info;
+    struct stat otherInfo;
+    if (stat(filename.c_str(), &info) != 0)
+        return false;
+    return (stat(otherFilename.c_str(), &otherInfo) != 0 || info.st_mtime >= otherInfo.st_mtime);
+}
+
 void LevelLoader::clear()
 {
     levelData.clear();
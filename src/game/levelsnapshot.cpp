@@ -0,0 +1,54 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "levelsnapshot.h"
+#include "tilemapchanger.h"
+#include "magicwindow.h"
+
+LevelSnapshot::LevelSnapshot(TileMapData& tileMapData, TileMapChanger& tileMapChanger, es::World& world, MagicWindow& magicWindow):
+    tileMapData(tileMapData),
+    tileMapChanger(tileMapChanger),
+    world(world),
+    magicWindow(magicWindow),
+    saved(false)
+{
+}
+
+void LevelSnapshot::save()
+{
+    tileMapData.saveSnapshot(tiles);
+
+    // Copy all of the entities into a separate world
+    entities.clear();
+    for (auto ent: world.query())
+        ent.clone(entities, ent.getName());
+
+    saved = true;
+}
+
+bool LevelSnapshot::restore()
+{
+    if (!saved)
+        return false;
+
+    // Restore the tiles, and update the visual tiles from them
+    tileMapData.restoreSnapshot(tiles);
+    tileMapChanger.updateVisualTiles();
+
+    // Replace all of the entities with copies of the saved ones
+    world.clear();
+    for (auto ent: entities.query())
+        ent.clone(world, ent.getName());
+
+    // Reset window
+    magicWindow.show(false);
+    magicWindow.setSize();
+
+    return true;
+}
+
+void LevelSnapshot::clear()
+{
+    entities.clear();
+    saved = false;
+}
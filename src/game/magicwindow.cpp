@@ -124,6 +124,11 @@ bool MagicWindow::isWithin(const sf::FloatRect& aabb) const
     return (visible && sf::FloatRect(position.x, position.y, size.x, size.y).intersects(aabb));
 }
 
+sf::FloatRect MagicWindow::getBounds() const
+{
+    return sf::FloatRect(position, size);
+}
+
 void MagicWindow::show(bool state)
 {
     visible = state;
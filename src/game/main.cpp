@@ -8,9 +8,12 @@
 #include "leveleditorstate.h"
 #include "aboutstate.h"
 #include "finalstate.h"
+#include "virtualfilesystem.h"
 
 int main()
 {
+    // Loose files in data/ are still used over the pack, unless built with PACKED_ASSETS_ONLY
+    VirtualFileSystem::mount("assets.pack");
     GameResources resources("Multiversal v0.3.0 Alpha");
     ng::StateStack states;
     states.add<MenuState>("Menu", resources);
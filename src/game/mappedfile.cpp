@@ -0,0 +1,122 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "mappedfile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define MAPPEDFILE_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile():
+    fileData(nullptr),
+    fileSize(0),
+    mapped(false),
+    opened(false)
+{
+}
+
+MappedFile::MappedFile(const std::string& filename):
+    MappedFile()
+{
+    open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef MAPPEDFILE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0)
+    {
+        fileSize = info.st_size;
+        if (fileSize == 0)
+            opened = true; // Empty files can't be mapped, but are still valid
+        else
+        {
+            void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                fileData = static_cast<const char*>(address);
+                mapped = true;
+                opened = true;
+            }
+        }
+    }
+    ::close(fd);
+
+    // Fall back to reading the file if it couldn't be mapped
+    if (!opened)
+        return readIntoBuffer(filename);
+    return true;
+#else
+    return readIntoBuffer(filename);
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef MAPPEDFILE_MMAP
+    if (mapped)
+        munmap(const_cast<char*>(fileData), fileSize);
+#endif
+    fileData = nullptr;
+    fileSize = 0;
+    mapped = false;
+    opened = false;
+    buffer.clear();
+}
+
+bool MappedFile::isOpen() const
+{
+    return opened;
+}
+
+const char* MappedFile::data() const
+{
+    return fileData;
+}
+
+std::size_t MappedFile::size() const
+{
+    return fileSize;
+}
+
+bool MappedFile::readIntoBuffer(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+
+    file.seekg(0, std::ios::end);
+    auto length = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (length < 0)
+        return false;
+
+    buffer.resize(static_cast<std::size_t>(length));
+    if (!buffer.empty() && !file.read(buffer.data(), buffer.size()))
+    {
+        buffer.clear();
+        return false;
+    }
+
+    fileData = buffer.data();
+    fileSize = buffer.size();
+    opened = true;
+    return true;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "positionhistory.h"
+#include "components.h"
+
+PositionHistory::PositionHistory(es::World& world):
+    world(world),
+    alpha(1)
+{
+}
+
+void PositionHistory::save()
+{
+    positions.clear();
+    for (auto ent: world.query<Position>())
+    {
+        auto position = ent.getPtr<Position>();
+        positions[ent.getId()] = sf::Vector2f(position->x, position->y);
+    }
+}
+
+void PositionHistory::clear()
+{
+    positions.clear();
+    alpha = 1;
+}
+
+void PositionHistory::setAlpha(float newAlpha)
+{
+    alpha = newAlpha;
+}
+
+sf::Vector2f PositionHistory::get(es::Entity& ent) const
+{
+    auto position = ent.getPtr<Position>();
+    sf::Vector2f current(position->x, position->y);
+    auto found = positions.find(ent.getId());
+    if (found == positions.end())
+        return current;
+    return found->second + (current - found->second) * alpha;
+}
@@ -7,6 +7,7 @@
 #include "es/events.h"
 #include "gameevents.h"
 #include "components.h"
+#include "virtualfilesystem.h"
 
 SelectionGUI::SelectionGUI(GameInstance& gameInstance, sf::RenderWindow& window, es::World& palette):
     gameInstance(gameInstance),
@@ -52,7 +53,7 @@ SelectionGUI::SelectionGUI(GameInstance& gameInstance, sf::RenderWindow& window,
     border.setOutlineThickness(PADDING);
 
     // Setup tabs
-    font.loadFromFile("data/fonts/Ubuntu-B.ttf");
+    VirtualFileSystem::loadResource("data/fonts/Ubuntu-B.ttf", font, fontData);
     const sf::Vector2u tabSize(BUTTON_WIDTH, BUTTON_HEIGHT);
     auto& tilesTab = tabs["tiles"];
     auto& objectsTab = tabs["world"];
@@ -0,0 +1,160 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "spatialhash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash():
+    cellSize(1, 1),
+    currentStamp(0)
+{
+}
+
+void SpatialHash::setCellSize(const sf::Vector2u& size)
+{
+    clear();
+    cellSize.x = std::max(size.x, 1u);
+    cellSize.y = std::max(size.y, 1u);
+}
+
+void SpatialHash::clear()
+{
+    cells.clear();
+    items.clear();
+}
+
+void SpatialHash::beginUpdate()
+{
+    ++currentStamp;
+}
+
+void SpatialHash::endUpdate()
+{
+    // Remove entities that were not updated (destroyed or lost a component)
+    for (auto it = items.begin(); it != items.end(); )
+    {
+        if (it->second.stamp != currentStamp)
+        {
+            removeCells(it->first, it->second.cells);
+            it = items.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+bool SpatialHash::update(es::ID id, const sf::FloatRect& bounds)
+{
+    auto newCells = getCellRange(bounds);
+    auto found = items.find(id);
+    bool changed = true;
+    if (found == items.end())
+    {
+        // Insert a new entity
+        auto& item = items[id];
+        item.cells = newCells;
+        item.stamp = currentStamp;
+        insertCells(id, newCells);
+    }
+    else
+    {
+        // Only touch the cells if the entity moved into different ones
+        auto& item = found->second;
+        item.stamp = currentStamp;
+        changed = (item.cells != newCells);
+        if (changed)
+        {
+            removeCells(id, item.cells);
+            insertCells(id, newCells);
+            item.cells = newCells;
+        }
+    }
+    return changed;
+}
+
+void SpatialHash::remove(es::ID id)
+{
+    auto found = items.find(id);
+    if (found != items.end())
+    {
+        removeCells(id, found->second.cells);
+        items.erase(found);
+    }
+}
+
+void SpatialHash::query(const sf::FloatRect& bounds, std::vector<es::ID>& results) const
+{
+    auto start = results.size();
+    auto range = getCellRange(bounds);
+    for (int y = range.top; y <= range.bottom; ++y)
+    {
+        for (int x = range.left; x <= range.right; ++x)
+        {
+            auto found = cells.find(getKey(x, y));
+            if (found != cells.end())
+                results.insert(results.end(), found->second.begin(), found->second.end());
+        }
+    }
+
+    // Entities spanning multiple cells are found more than once
+    std::sort(results.begin() + start, results.end());
+    results.erase(std::unique(results.begin() + start, results.end()), results.end());
+}
+
+bool SpatialHash::CellRange::operator==(const CellRange& other) const
+{
+    return (left == other.left && top == other.top && right == other.right && bottom == other.bottom);
+}
+
+bool SpatialHash::CellRange::operator!=(const CellRange& other) const
+{
+    return !(*this == other);
+}
+
+SpatialHash::CellRange SpatialHash::getCellRange(const sf::FloatRect& bounds) const
+{
+    // Touching edges are included, so any two intersecting boxes share a cell
+    CellRange range;
+    range.left = std::floor(bounds.left / cellSize.x);
+    range.top = std::floor(bounds.top / cellSize.y);
+    range.right = std::floor((bounds.left + bounds.width) / cellSize.x);
+    range.bottom = std::floor((bounds.top + bounds.height) / cellSize.y);
+    return range;
+}
+
+SpatialHash::Key SpatialHash::getKey(int x, int y)
+{
+    return static_cast<Key>((static_cast<unsigned long long>(static_cast<unsigned>(x)) << 32) | static_cast<unsigned>(y));
+}
+
+void SpatialHash::insertCells(es::ID id, const CellRange& range)
+{
+    for (int y = range.top; y <= range.bottom; ++y)
+    {
+        for (int x = range.left; x <= range.right; ++x)
+            cells[getKey(x, y)].push_back(id);
+    }
+}
+
+void SpatialHash::removeCells(es::ID id, const CellRange& range)
+{
+    for (int y = range.top; y <= range.bottom; ++y)
+    {
+        for (int x = range.left; x <= range.right; ++x)
+        {
+            auto found = cells.find(getKey(x, y));
+            if (found != cells.end())
+            {
+                // Swap and pop, the order within a cell does not matter
+                auto& cell = found->second;
+                auto it = std::find(cell.begin(), cell.end(), id);
+                if (it != cell.end())
+                {
+                    *it = cell.back();
+                    cell.pop_back();
+                }
+            }
+        }
+    }
+}
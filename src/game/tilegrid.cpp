@@ -0,0 +1,49 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "tilegrid.h"
+#include <climits>
+
+namespace TileGrid
+{
+
+bool readInt(const char*& begin, const char* end, int& value)
+{
+    bool negative = (begin != end && *begin == '-');
+    if (negative)
+        ++begin;
+
+    // Accumulate digits, anything else (or a number too big for an int) makes the whole number invalid
+    int result = 0;
+    bool valid = (begin != end && *begin != ' ' && *begin != '\t');
+    for (; begin != end && *begin != ' ' && *begin != '\t'; ++begin)
+    {
+        int digit = *begin - '0';
+        if (digit < 0 || digit > 9 || result > (INT_MAX - digit) / 10)
+            valid = false;
+        else if (valid)
+            result = result * 10 + digit;
+    }
+
+    value = (valid ? (negative ? -result : result) : 0);
+    return valid;
+}
+
+void writeInt(std::string& buffer, int value)
+{
+    // Write the digits backwards into a small buffer, then append them
+    char digits[12];
+    char* pos = digits + sizeof(digits);
+    unsigned magnitude = (value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value));
+    do
+    {
+        *--pos = '0' + (magnitude % 10);
+        magnitude /= 10;
+    }
+    while (magnitude);
+    if (value < 0)
+        *--pos = '-';
+    buffer.append(pos, digits + sizeof(digits));
+}
+
+}
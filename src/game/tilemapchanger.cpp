@@ -21,6 +21,7 @@ bool TileMapChanger::changeState(int tileId, bool state)
         tileMapData.updateVisualId(tileId);
         tileMapData.updateCollision(tileId);
         updateVisualTile(tileId);
+        tileMapData.logChange(tileId);
         stateChanged = true;
     }
     return stateChanged;
@@ -38,6 +39,14 @@ void TileMapChanger::updateVisualTile(int tileId)
         tileMapData.getY(tileId), tileMapData(tileId).visualId);
 }
 
+void TileMapChanger::updateVisualTiles()
+{
+    apply([&](unsigned x, unsigned y)
+    {
+        tileMap.set(x, y, tileMapData(x, y).visualId);
+    });
+}
+
 void TileMapChanger::resize(int width, int height)
 {
     if (width > 0 && height > 0)
@@ -45,12 +54,10 @@ void TileMapChanger::resize(int width, int height)
         tileMap.resize(width, height);
         tileMapData.resize(width, height);
         tileMapData.deriveTiles();
+        tileMapData.buildTileIds();
 
         // Update the visual tile map from the logical tile map
-        apply([&](unsigned x, unsigned y)
-        {
-            tileMap.set(x, y, tileMapData(x, y).visualId);
-        });
+        updateVisualTiles();
     }
 }
 
@@ -66,17 +73,11 @@ void TileMapChanger::clear()
 
 void TileMapChanger::apply(FuncType callback)
 {
-    // Invoke callback for each tile in every layer
+    // Invoke callback for each non-empty tile in every layer
     for (unsigned layer = 0; layer <= 1; ++layer)
     {
         tileMap.useLayer(layer);
         tileMapData.useLayer(layer);
-        unsigned height = tileMapData.height();
-        unsigned width = tileMapData.width();
-        for (unsigned y = 0; y < height; ++y)
-        {
-            for (unsigned x = 0; x < width; ++x)
-                callback(x, y);
-        }
+        tileMapData.forEachTile(layer, callback);
     }
 }
@@ -3,7 +3,13 @@
 
 #include "tilemapdata.h"
 #include "configfile.h"
+#include "logicaltiles.h"
+#include "virtualfilesystem.h"
+#ifdef BUILTIN_TILE_INFO
+#include "tileinfodata.h"
+#endif
 #include <iostream>
+#include <algorithm>
 
 void Tile::reset()
 {
@@ -14,56 +20,229 @@ void Tile::reset()
     state = false;
 }
 
+TileRef::TileRef(TileMapData& data, int layer, unsigned index):
+    logicalId(data, layer, index),
+    visualId(data, layer, index),
+    collidable(data, layer, index),
+    blocksLaser(data, layer, index),
+    state(data, layer, index)
+{
+}
+
+TileRef& TileRef::operator=(const TileRef& other)
+{
+    return (*this = static_cast<Tile>(other));
+}
+
+TileRef& TileRef::operator=(const Tile& tile)
+{
+    logicalId = tile.logicalId;
+    visualId = tile.visualId;
+    collidable = tile.collidable;
+    blocksLaser = tile.blocksLaser;
+    state = tile.state;
+    return *this;
+}
+
+TileRef::operator Tile() const
+{
+    Tile tile;
+    tile.logicalId = logicalId;
+    tile.visualId = visualId;
+    tile.collidable = collidable;
+    tile.blocksLaser = blocksLaser;
+    tile.state = state;
+    return tile;
+}
+
+void TileRef::reset()
+{
+    *this = Tile();
+}
+
 TileMapData::TileMapData():
-    currentLayer(0)
+    mapWidth(0),
+    mapHeight(0),
+    currentLayer(0),
+    currentObjectStamp(1),
+    changeLogEpoch(0)
 {
     loadTileInfo();
 }
 
-Tile& TileMapData::operator()(int layer, unsigned x, unsigned y)
+TileRef TileMapData::operator()(int layer, unsigned x, unsigned y)
+{
+    return TileRef(*this, layer, y * mapWidth + x);
+}
+
+TileRef TileMapData::operator()(unsigned x, unsigned y)
+{
+    return operator()(currentLayer, x, y);
+}
+
+TileRef TileMapData::operator()(int id)
+{
+    return operator()(getLayer(id), getX(id), getY(id));
+}
+
+Tile TileMapData::operator()(int layer, unsigned x, unsigned y) const
+{
+    Tile tile;
+    auto& tiles = layers[layer];
+    tile.logicalId = tiles.logicalIds.get(x, y);
+    tile.visualId = tiles.visualIds.get(x, y);
+    tile.collidable = tiles.collidable.get(x, y);
+    tile.blocksLaser = tiles.blocksLaser.get(x, y);
+    tile.state = tiles.state.get(x, y);
+    return tile;
+}
+
+Tile TileMapData::operator()(unsigned x, unsigned y) const
+{
+    return operator()(currentLayer, x, y);
+}
+
+Tile TileMapData::operator()(int id) const
+{
+    return operator()(getLayer(id), getX(id), getY(id));
+}
+
+int TileMapData::getLogicalId(int layer, unsigned x, unsigned y) const
+{
+    return layers[layer].logicalIds.get(x, y);
+}
+
+int TileMapData::getVisualId(int layer, unsigned x, unsigned y) const
+{
+    return layers[layer].visualIds.get(x, y);
+}
+
+bool TileMapData::getState(int layer, unsigned x, unsigned y) const
+{
+    return layers[layer].state.get(x, y);
+}
+
+bool TileMapData::anyCollidable(int layer, unsigned y, unsigned startX, unsigned endX) const
 {
-    return tiles[layer](x, y);
+    return layers[layer].collidable.any(y, startX, endX);
 }
 
-Tile& TileMapData::operator()(unsigned x, unsigned y)
+unsigned TileMapData::findLaserBlocker(int layer, unsigned x, unsigned y, const sf::Vector2i& direction, unsigned count) const
 {
-    return tiles[currentLayer](x, y);
+    if (count == 0)
+        return 0;
+
+    // Rows are scanned in the normal plane, and columns in the transposed plane
+    const auto& tiles = layers[layer];
+    bool vertical = (direction.x == 0);
+    const auto& plane = (vertical ? tiles.laserColumns : tiles.blocksLaser);
+    unsigned row = (vertical ? x : y);
+    unsigned start = (vertical ? y : x);
+    if ((vertical ? direction.y : direction.x) > 0)
+    {
+        int found = plane.findFirst(row, start, start + count - 1);
+        return (found < 0 ? count : found - start);
+    }
+    int found = plane.findLast(row, start - (count - 1), start);
+    return (found < 0 ? count : start - found);
 }
 
-Tile& TileMapData::operator()(int id)
+const BitPlane& TileMapData::getCollisionPlane(int layer) const
 {
-    return tiles[getLayer(id)](getX(id), getY(id));
+    return layers[layer].collidable;
 }
 
-const Tile& TileMapData::operator()(int layer, unsigned x, unsigned y) const
+const BitPlane& TileMapData::getLaserPlane(int layer) const
 {
-    return tiles[layer](x, y);
+    return layers[layer].blocksLaser;
 }
 
-const Tile& TileMapData::operator()(unsigned x, unsigned y) const
+int TileMapData::getField(int type, int layer, unsigned index) const
 {
-    return tiles[currentLayer](x, y);
+    auto& tiles = layers[layer];
+    unsigned x = index % mapWidth;
+    unsigned y = index / mapWidth;
+    switch (type)
+    {
+        case TileRef::LogicalId:
+            return tiles.logicalIds.get(x, y);
+        case TileRef::VisualId:
+            return tiles.visualIds.get(x, y);
+        case TileRef::Collidable:
+            return tiles.collidable.get(x, y);
+        case TileRef::BlocksLaser:
+            return tiles.blocksLaser.get(x, y);
+        case TileRef::State:
+            return tiles.state.get(x, y);
+        default:
+            return 0;
+    }
 }
 
-const Tile& TileMapData::operator()(int id) const
+void TileMapData::setField(int type, int layer, unsigned index, int value)
 {
-    return tiles[getLayer(id)](getX(id), getY(id));
+    auto& tiles = layers[layer];
+    unsigned x = index % mapWidth;
+    unsigned y = index / mapWidth;
+    switch (type)
+    {
+        case TileRef::LogicalId:
+            // IDs are stored in fewer bits than an int, so out of range IDs are rejected instead of wrapping
+            if (static_cast<unsigned>(value) < LOGICAL_ID_COUNT)
+                tiles.logicalIds.set(x, y, value);
+            else
+                std::cerr << "Logical ID out of range: " << value << "\n";
+            break;
+        case TileRef::VisualId:
+            if (static_cast<unsigned>(value) < VISUAL_ID_COUNT)
+                tiles.visualIds.set(x, y, value);
+            else
+                std::cerr << "Visual ID out of range: " << value << "\n";
+            break;
+        case TileRef::Collidable:
+            tiles.collidable.set(x, y, value != 0);
+            break;
+        case TileRef::BlocksLaser:
+            tiles.blocksLaser.set(x, y, value != 0);
+            tiles.laserColumns.set(y, x, value != 0);
+            break;
+        case TileRef::State:
+            tiles.state.set(x, y, value != 0);
+            break;
+        default:
+            break;
+    }
 }
 
 void TileMapData::resize(unsigned width, unsigned height, bool preserve)
 {
-    for (auto& layer: tiles)
-        layer.resize(width, height, preserve);
+    for (auto& tiles: layers)
+    {
+        tiles.logicalIds.resize(width, height, preserve);
+        tiles.visualIds.resize(width, height, preserve);
+        tiles.collidable.resize(width, height, preserve);
+        tiles.blocksLaser.resize(width, height, preserve);
+        tiles.laserColumns.resize(height, width, preserve);
+        tiles.state.resize(width, height, preserve);
+    }
+    mapWidth = width;
+    mapHeight = height;
+
+    // Tile IDs depend on the size, so these are no longer valid
+    objectStamps.assign(2 * width * height, 0);
+    currentObjectStamp = 1;
+    clearTileIds();
+    clearChangeLog();
 }
 
 unsigned TileMapData::width() const
 {
-    return tiles[0].width();
+    return mapWidth;
 }
 
 unsigned TileMapData::height() const
 {
-    return tiles[0].height();
+    return mapHeight;
 }
 
 sf::Vector2u TileMapData::size() const
@@ -93,124 +272,264 @@ int TileMapData::getId(unsigned x, unsigned y) const
 
 int TileMapData::getId(int layer, unsigned x, unsigned y) const
 {
-    return (layer * tiles[layer].size() + y * tiles[layer].width() + x);
+    return (layer * mapWidth * mapHeight + y * mapWidth + x);
 }
 
 void TileMapData::deriveTiles()
 {
-    for (auto& layer: tiles)
+    for (int layer = 0; layer <= 1; ++layer)
     {
-        for (auto& tile: layer)
+        // Empty tiles have no state or collision, so only the allocated chunks need to be derived
+        auto& tiles = layers[layer];
+        tiles.collidable.clear();
+        tiles.blocksLaser.clear();
+        tiles.laserColumns.clear();
+        tiles.state.clear();
+        forEachChunk(layer, [&](unsigned startX, unsigned startY, unsigned endX, unsigned endY)
         {
-            updateState(tile);
-            updateCollision(tile);
-        }
+            // Chunks never cross a word boundary in the bit planes
+            unsigned word = startX / BitPlane::WORD_BITS;
+            unsigned shift = startX % BitPlane::WORD_BITS;
+            for (unsigned y = startY; y < endY; ++y)
+            {
+                // Derive a row of the chunk at once, then write each bit plane with one operation
+                const auto* logicalIds = tiles.logicalIds.getRow(startX, y);
+                const auto* visualIds = tiles.visualIds.getRow(startX, y);
+                BitPlane::Word stateBits = 0;
+                BitPlane::Word collisionBits = 0;
+                BitPlane::Word laserBits = 0;
+                for (unsigned i = 0; i < endX - startX; ++i)
+                {
+                    unsigned state = (visualToState[visualIds[i]] > 0);
+                    const auto& tileInfo = logicalToInfo[logicalIds[i]];
+                    bool blocksLaser = tileInfo.collision[TileInfo::LaserCollision + state];
+                    stateBits |= BitPlane::Word(state) << i;
+                    collisionBits |= BitPlane::Word(tileInfo.collision[TileInfo::Collision + state]) << i;
+                    laserBits |= BitPlane::Word(blocksLaser) << i;
+                    if (blocksLaser)
+                        tiles.laserColumns.set(y, startX + i, true);
+                }
+                tiles.state.getRow(y)[word] |= (stateBits << shift);
+                tiles.collidable.getRow(y)[word] |= (collisionBits << shift);
+                tiles.blocksLaser.getRow(y)[word] |= (laserBits << shift);
+            }
+        });
     }
 }
 
 void TileMapData::updateVisualId(int id)
 {
-    updateVisualId(operator()(id));
+    updateVisualId(getLayer(id), getX(id), getY(id));
 }
 
 void TileMapData::updateVisualId(Tile& tile)
 {
-    auto& tileInfo = logicalToInfo[tile.logicalId];
+    auto& tileInfo = getTileInfo(tile.logicalId);
     if (tileInfo.stateToVisualUsed)
         tile.visualId = tileInfo.stateToVisual[tile.state];
 }
 
 void TileMapData::updateCollision(int id)
 {
-    updateCollision(operator()(id));
+    updateCollision(getLayer(id), getX(id), getY(id));
 }
 
 void TileMapData::updateCollision(Tile& tile)
 {
     // Get the normal/laser collision data based on the logical ID
-    auto& tileInfo = logicalToInfo[tile.logicalId];
+    auto& tileInfo = getTileInfo(tile.logicalId);
     tile.collidable = tileInfo.collision[TileInfo::Collision + tile.state];
     tile.blocksLaser = tileInfo.collision[TileInfo::LaserCollision + tile.state];
 }
 
 void TileMapData::updateState(int id)
 {
-    updateState(operator()(id));
+    updateState(getLayer(id), getX(id), getY(id));
 }
 
 void TileMapData::updateState(Tile& tile)
 {
-    auto found = visualToInfo.find(tile.visualId);
-    if (found != visualToInfo.end())
-        tile.state = found->second.state;
+    int state = getVisualState(tile.visualId);
+    if (state >= 0)
+        tile.state = state;
+}
+
+void TileMapData::updateVisualId(int layer, unsigned x, unsigned y)
+{
+    auto& tiles = layers[layer];
+    auto& tileInfo = logicalToInfo[tiles.logicalIds.get(x, y)];
+    if (tileInfo.stateToVisualUsed)
+        tiles.visualIds.set(x, y, tileInfo.stateToVisual[tiles.state.get(x, y)]);
+}
+
+void TileMapData::updateCollision(int layer, unsigned x, unsigned y)
+{
+    // Get the normal/laser collision data based on the logical ID
+    auto& tiles = layers[layer];
+    auto& tileInfo = logicalToInfo[tiles.logicalIds.get(x, y)];
+    bool state = tiles.state.get(x, y);
+    tiles.collidable.set(x, y, tileInfo.collision[TileInfo::Collision + state]);
+    tiles.blocksLaser.set(x, y, tileInfo.collision[TileInfo::LaserCollision + state]);
+    tiles.laserColumns.set(y, x, tileInfo.collision[TileInfo::LaserCollision + state]);
+}
+
+void TileMapData::updateState(int layer, unsigned x, unsigned y)
+{
+    auto& tiles = layers[layer];
+    int state = visualToState[tiles.visualIds.get(x, y)];
+    if (state >= 0)
+        tiles.state.set(x, y, state);
 }
 
 void TileMapData::addTile(int id)
 {
-    tilesWithObjectsOnTop.insert(id);
+    if (id >= 0 && static_cast<unsigned>(id) < objectStamps.size())
+        objectStamps[id] = currentObjectStamp;
 }
 
 bool TileMapData::findTile(int id) const
 {
-    return (tilesWithObjectsOnTop.find(id) != tilesWithObjectsOnTop.end());
+    return (id >= 0 && static_cast<unsigned>(id) < objectStamps.size() && objectStamps[id] == currentObjectStamp);
 }
 
 void TileMapData::clearTiles()
 {
-    tilesWithObjectsOnTop.clear();
+    // Old stamps no longer match, only reset them when the stamp wraps around
+    if (++currentObjectStamp == 0)
+    {
+        std::fill(objectStamps.begin(), objectStamps.end(), 0);
+        currentObjectStamp = 1;
+    }
+}
+
+void TileMapData::logChange(int id)
+{
+    // Start over when the log gets too long, readers will treat it as if everything changed
+    if (changeLog.size() >= MAX_CHANGE_LOG)
+        clearChangeLog();
+    changeLog.push_back(id);
+}
+
+void TileMapData::clearChangeLog()
+{
+    changeLog.clear();
+    ++changeLogEpoch;
+}
+
+TileMapData::TileList TileMapData::operator[](int logicalId) const
+{
+    if (logicalId < 0 || static_cast<unsigned>(logicalId) + 1 >= tileIdOffsets.size())
+        return TileList{nullptr, nullptr};
+    const int* first = tileIdList.data();
+    return TileList{first + tileIdOffsets[logicalId], first + tileIdOffsets[logicalId + 1]};
 }
 
-TileMapData::TileList& TileMapData::operator[](int logicalId)
+void TileMapData::buildTileIds()
 {
-    return tileIds[logicalId];
+    // Count the tiles of each logical ID
+    const unsigned idCount = LOGICAL_ID_COUNT;
+    tileIdOffsets.assign(idCount + 1, 0);
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        forEachTile(layer, [&](unsigned x, unsigned y)
+        {
+            ++tileIdOffsets[layers[layer].logicalIds.get(x, y) + 1];
+        });
+    }
+    tileIdOffsets[Tiles::None + 1] = 0;
+    tileIdOffsets[Tiles::Normal + 1] = 0;
+
+    // Turn the counts into offsets, then fill in the tile IDs in order
+    for (unsigned id = 0; id < idCount; ++id)
+        tileIdOffsets[id + 1] += tileIdOffsets[id];
+    tileIdList.resize(tileIdOffsets[idCount]);
+    std::vector<unsigned> next(tileIdOffsets.begin(), tileIdOffsets.end() - 1);
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        forEachTile(layer, [&](unsigned x, unsigned y)
+        {
+            int logicalId = layers[layer].logicalIds.get(x, y);
+            if (logicalId != Tiles::None && logicalId != Tiles::Normal)
+                tileIdList[next[logicalId]++] = getId(layer, x, y);
+        });
+    }
+
+    // Tiles were visited a chunk at a time, so put each list back in row order
+    for (unsigned id = 0; id < idCount; ++id)
+        std::sort(tileIdList.begin() + tileIdOffsets[id], tileIdList.begin() + tileIdOffsets[id + 1]);
 }
 
 void TileMapData::clearTileIds()
 {
-    tileIds.clear();
+    tileIdOffsets.clear();
+    tileIdList.clear();
+}
+
+void TileMapData::saveSnapshot(Snapshot& snapshot) const
+{
+    for (int layer = 0; layer <= 1; ++layer)
+        snapshot.layers[layer] = layers[layer];
+    snapshot.mapWidth = mapWidth;
+    snapshot.mapHeight = mapHeight;
+    snapshot.tileIdOffsets = tileIdOffsets;
+    snapshot.tileIdList = tileIdList;
+}
+
+void TileMapData::restoreSnapshot(const Snapshot& snapshot)
+{
+    if (mapWidth != snapshot.mapWidth || mapHeight != snapshot.mapHeight)
+    {
+        objectStamps.assign(2 * snapshot.mapWidth * snapshot.mapHeight, 0);
+        currentObjectStamp = 1;
+    }
+    else
+        clearTiles();
+    for (int layer = 0; layer <= 1; ++layer)
+        layers[layer] = snapshot.layers[layer];
+    mapWidth = snapshot.mapWidth;
+    mapHeight = snapshot.mapHeight;
+    tileIdOffsets = snapshot.tileIdOffsets;
+    tileIdList = snapshot.tileIdList;
+    clearChangeLog();
 }
 
 int TileMapData::getLayer(int id) const
 {
-    return (id / tiles[currentLayer].size());
+    return (id / (mapWidth * mapHeight));
 }
 
 unsigned TileMapData::getX(int id) const
 {
-    return ((id % tiles[currentLayer].size()) % tiles[currentLayer].width());
+    return ((id % (mapWidth * mapHeight)) % mapWidth);
 }
 
 unsigned TileMapData::getY(int id) const
 {
-    return ((id % tiles[currentLayer].size()) / tiles[currentLayer].width());
+    return ((id % (mapWidth * mapHeight)) / mapWidth);
 }
 
 void TileMapData::loadTileInfo()
 {
-    cfg::File config("data/config/tile_info.cfg");
+    logicalToInfo.assign(LOGICAL_ID_COUNT, TileInfo());
+    visualToState.assign(VISUAL_ID_COUNT, -1);
+    visualToInfo.clear();
+
+#ifdef BUILTIN_TILE_INFO
+    // Use the tables generated from the config file at build time
+    for (const auto& values: TileInfoData::logical)
+        addTileInfo(values[0], values + 1, (values[TileInfo::StateToVisual + 1] >= 0 ? 6 : 4));
+    for (const auto& values: TileInfoData::visual)
+        addVisualInfo(values[0], values[1], values[2] != 0);
+#else
+    cfg::File config;
+    VirtualFileSystem::loadConfig("data/config/tile_info.cfg", config);
 
     // Load all of the information about certain logical tiles
     for (auto& option: config.getSection("TileInfo"))
     {
         int logicalId = strlib::fromString<int>(option.first);
         auto values = strlib::split<int>(option.second, " ");
-        if (values.size() > TileInfo::LaserCollisionTrue)
-        {
-            auto& tileInfo = logicalToInfo[logicalId];
-
-            // Extract collision properties
-            unsigned index = 0;
-            for (bool& col: tileInfo.collision)
-                col = (values[index++] != 0);
-
-            // Extract visual ID information
-            if (values.size() > TileInfo::StateToVisualTrue)
-            {
-                tileInfo.stateToVisual[0] = values[TileInfo::StateToVisual];
-                tileInfo.stateToVisual[1] = values[TileInfo::StateToVisualTrue];
-                tileInfo.stateToVisualUsed = true;
-            }
-        }
+        addTileInfo(logicalId, values.data(), values.size());
     }
 
     // Load visual tile reverse lookup table
@@ -218,11 +537,40 @@ void TileMapData::loadTileInfo()
     {
         int visualId = strlib::fromString<int>(option.first);
         auto values = strlib::split<int>(option.second, " ");
+        if (!values.empty())
+            addVisualInfo(visualId, values.front(), (values.size() >= 2 && values[1] != 0));
+    }
+#endif
+}
+
+void TileMapData::addTileInfo(int logicalId, const int* values, unsigned count)
+{
+    if (count > TileInfo::LaserCollisionTrue && static_cast<unsigned>(logicalId) < LOGICAL_ID_COUNT)
+    {
+        auto& tileInfo = logicalToInfo[logicalId];
+
+        // Extract collision properties
+        unsigned index = 0;
+        for (bool& col: tileInfo.collision)
+            col = (values[index++] != 0);
 
-        // Extract logical ID and state
+        // Extract visual ID information
+        if (count > TileInfo::StateToVisualTrue)
+        {
+            tileInfo.stateToVisual[0] = values[TileInfo::StateToVisual];
+            tileInfo.stateToVisual[1] = values[TileInfo::StateToVisualTrue];
+            tileInfo.stateToVisualUsed = true;
+        }
+    }
+}
+
+void TileMapData::addVisualInfo(int visualId, int logicalId, bool state)
+{
+    if (static_cast<unsigned>(visualId) < VISUAL_ID_COUNT)
+    {
         auto& info = visualToInfo[visualId];
-        info.logicalId = values.front();
-        if (values.size() >= 2)
-            info.state = (values[1] != 0);
+        info.logicalId = logicalId;
+        info.state = state;
+        visualToState[visualId] = state;
     }
 }
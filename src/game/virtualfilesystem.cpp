@@ -0,0 +1,78 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "virtualfilesystem.h"
+#include "assetpack.h"
+#include "mappedfile.h"
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+AssetPack& getPack()
+{
+    static AssetPack pack;
+    return pack;
+}
+
+}
+
+bool VirtualFileSystem::mount(const std::string& filename)
+{
+    bool status = getPack().open(filename);
+    if (status)
+        std::cout << "Mounted asset pack: " << filename << "\n";
+    return status;
+}
+
+void VirtualFileSystem::unmount()
+{
+    getPack().close();
+}
+
+bool VirtualFileSystem::isMounted()
+{
+    return getPack().isOpen();
+}
+
+bool VirtualFileSystem::exists(const std::string& filename)
+{
+    const char* data = nullptr;
+    std::size_t size = 0;
+#ifndef PACKED_ASSETS_ONLY
+    if (std::ifstream(filename))
+        return true;
+#endif
+    return getPack().find(filename, data, size);
+}
+
+bool VirtualFileSystem::read(const std::string& filename, std::string& data)
+{
+    const char* view = nullptr;
+    std::size_t size = 0;
+    MappedFile looseFile;
+    if (!getView(filename, view, size, looseFile))
+        return false;
+    data.assign(view, size);
+    return true;
+}
+
+bool VirtualFileSystem::getView(const std::string& filename, const char*& data, std::size_t& size, MappedFile& looseFile)
+{
+#ifndef PACKED_ASSETS_ONLY
+    if (looseFile.open(filename))
+    {
+        data = looseFile.data();
+        size = looseFile.size();
+        return true;
+    }
+#endif
+    return getPack().find(filename, data, size);
+}
+
+bool VirtualFileSystem::loadConfig(const std::string& filename, cfg::File& config)
+{
+    std::string data;
+    return (read(filename, data) && config.loadFromString(data));
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "workerpool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned threadCount):
+    currentTask(nullptr),
+    taskCount(0),
+    nextIndex(0),
+    busyWorkers(0),
+    generation(0),
+    stopping(false)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // The calling thread counts as one of the threads
+    for (unsigned i = 1; i < threadCount; ++i)
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& thread: threads)
+        thread.join();
+}
+
+void WorkerPool::run(std::size_t count, const Task& task)
+{
+    if (count == 0)
+        return;
+
+    // Small loops aren't worth waking up the other threads for
+    if (count == 1 || threads.empty())
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        taskCount = count;
+        nextIndex = 0;
+        busyWorkers = threads.size();
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    work();
+
+    // Wait for the other threads to finish their last iterations
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [&]{ return busyWorkers == 0; });
+    currentTask = nullptr;
+}
+
+unsigned WorkerPool::size() const
+{
+    return threads.size() + 1;
+}
+
+void WorkerPool::workerLoop()
+{
+    unsigned lastGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&]{ return stopping || generation != lastGeneration; });
+            if (stopping)
+                return;
+            lastGeneration = generation;
+        }
+
+        work();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void WorkerPool::work()
+{
+    for (std::size_t i = nextIndex++; i < taskCount; i = nextIndex++)
+        (*currentTask)(i);
+}
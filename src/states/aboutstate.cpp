@@ -6,6 +6,7 @@
 #include "nage/graphics/spriteloader.h"
 #include "nage/graphics/colorcode.h"
 #include "nage/graphics/vectors.h"
+#include "virtualfilesystem.h"
 
 AboutState::AboutState(GameResources& resources):
     resources(resources)
@@ -42,8 +43,9 @@ void AboutState::setup()
 {
     // Load files and settings
     ng::SpriteLoader::load(bgSprite, "data/images/menu_bg.png", true);
-    cfg::File config("data/config/about.cfg");
-    font.loadFromFile(config("font"));
+    cfg::File config;
+    VirtualFileSystem::loadConfig("data/config/about.cfg", config);
+    VirtualFileSystem::loadResource(config("font"), font, fontData);
     int fontSize = config("fontSize").toInt();
     int padding = config("padding").toInt();
     ng::ColorCode fontColor(config("fontColor"));
@@ -5,10 +5,21 @@
 #include "gameresources.h"
 #include "es/events.h"
 #include "gameevents.h"
-#include "components.h"
-#include "movingcomponent.h"
-#include "lasercomponent.h"
-#include "es/entityprototypeloader.h"
+#include "gamecomponents.h"
+#include "inputsystem.h"
+#include "movingsystem.h"
+#include "playersystem.h"
+#include "physicssystem.h"
+#include "carrysystem.h"
+#include "spritesystem.h"
+#include "camerasystem.h"
+#include "tilesystem.h"
+#include "switchsystem.h"
+#include "objectswitchsystem.h"
+#include "tilegroupsystem.h"
+#include "lasersystem.h"
+#include "rendersystem.h"
+#include "tilesmoothingsystem.h"
 #include <iostream>
 
 GameState::GameState(GameResources& resources):
@@ -16,10 +27,16 @@ GameState::GameState(GameResources& resources):
     gameInstance(resources.window, resources.gameSave)
 {
     // Register components and load entity prototypes
-    es::registerComponents<Position, Velocity, Size, AABB, Sprite, AnimSprite, Jumpable, ObjectState, Movable, Carrier, Gravity, State, TileGroup, TilePosition, Rotation, Switch, InitialPosition, Prototype, CameraUpdater, AltWorld, DrawOnTop, Carryable, AboveWindow, Rigid, ExcludeFromLevel, Moving, Laser>();
-    if (!es::loadPrototypes("data/config/entities.cfg"))
+    if (!setupGameComponents())
         std::cerr << "ERROR: Could not load object prototypes.\n";
 
+    // Setup the simulation rate
+    resources.config.useSection("Simulation");
+    timestep.setTickRate(resources.config("tickRate").toFloat());
+    timestep.setMaxTicksPerFrame(resources.config("maxTicksPerFrame").toInt());
+    PhysicsSystem::setThreadCount(resources.config("physicsThreads").toInt());
+    resources.config.useSection();
+
     // Link action callbacks
     gameInstance.actions("Game", "restartLevel").setCallback([]{ es::Events::send(ReloadLevelEvent{}); });
     gameInstance.actions("Game", "toggleMute").setCallback([&]{ resources.music.mute(); });
@@ -33,6 +50,8 @@ void GameState::onStart()
         gameInstance.levelLoader.clear();
     gameInstance.levelLoader.load();
     gameInstance.systems.initializeAll();
+    gameInstance.levelSnapshot.save();
+    resetSimulation();
 
     // Start the game music
     // resources.music.play("game");
@@ -49,21 +68,43 @@ void GameState::handleEvents()
 
 void GameState::update()
 {
+    // Restart the level from the snapshot (only the systems storing entity IDs need to be initialized)
+    if (es::Events::exists<ReloadLevelEvent>() && gameInstance.levelSnapshot.restore())
+    {
+        es::Events::clearAll();
+        gameInstance.systems.initialize<PlayerSystem>();
+        gameInstance.systems.initialize<PhysicsSystem>();
+        gameInstance.systems.initialize<TileSystem>();
+        resetSimulation();
+    }
+
     // Load the next level if needed
     if (gameInstance.levelLoader.update())
+    {
         gameInstance.systems.initializeAll();
+        gameInstance.levelSnapshot.save();
+        resetSimulation();
+    }
 
     // Update the game view
     es::Events::send(ViewEvent{gameInstance.camera.getView("game")});
 
-    es::Events::clear<ActionKeyEvent>();
-
     // Handle the events
     for (auto& event: es::Events::get<sf::Event>())
         gameInstance.actions.handleEvent(event);
 
-    // Update all of the systems
-    gameInstance.systems.updateAll(dt);
+    // Run the simulation at a fixed rate, which may take any number of ticks this frame
+    gameInstance.systems.update<InputSystem>(dt);
+    unsigned ticks = timestep.addFrameTime(dt);
+    for (unsigned i = 0; i < ticks; ++i)
+        updateSimulation(timestep.getTickTime());
+
+    // Draw the frame in between the last two ticks
+    gameInstance.positionHistory.setAlpha(timestep.getAlpha());
+    gameInstance.systems.update<SpriteSystem>(dt);
+    gameInstance.systems.update<CameraSystem>(dt);
+    gameInstance.systems.update<RenderSystem>(dt);
+    gameInstance.systems.update<TileSmoothingSystem>(dt);
 
     // Update the magic window
     gameInstance.magicWindow.update();
@@ -78,3 +119,26 @@ void GameState::update()
 
     resources.music.update();
 }
+
+void GameState::updateSimulation(float tickTime)
+{
+    gameInstance.positionHistory.save();
+    gameInstance.systems.update<MovingSystem>(tickTime);
+    gameInstance.systems.update<PlayerSystem>(tickTime);
+    gameInstance.systems.update<PhysicsSystem>(tickTime);
+    gameInstance.systems.update<CarrySystem>(tickTime);
+    gameInstance.systems.update<TileSystem>(tickTime);
+    gameInstance.systems.update<SwitchSystem>(tickTime);
+    gameInstance.systems.update<ObjectSwitchSystem>(tickTime);
+    gameInstance.systems.update<TileGroupSystem>(tickTime);
+    gameInstance.systems.update<LaserSystem>(tickTime);
+
+    // Action key presses are handled by the first tick after them
+    es::Events::clear<ActionKeyEvent>();
+}
+
+void GameState::resetSimulation()
+{
+    timestep.reset();
+    gameInstance.positionHistory.clear();
+}
@@ -2,28 +2,32 @@
 // This code is licensed under GPLv3, see LICENSE.txt for details.
 
 #include "lasersystem.h"
-#include "nage/graphics/spriteloader.h"
 #include "tilemapdata.h"
 #include "nage/graphics/tilemap.h"
 #include "magicwindow.h"
+#include "compositelayer.h"
+#include "beambatch.h"
 #include "logicaltiles.h"
 #include "nage/graphics/vectors.h"
 #include "es/events.h"
 #include "gameevents.h"
+#include "inaltworld.h"
 #include <cmath>
+#include <algorithm>
+#include <cstdlib>
 
-const char* LaserSystem::textureFilename = "data/images/beam.png";
-
-LaserSystem::LaserSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow):
+LaserSystem::LaserSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow, CompositeLayer& compositeLayer, BeamBatch& beamBatch):
     world(world),
     tileMapData(tileMapData),
     tileMap(tileMap),
-    magicWindow(magicWindow)
+    magicWindow(magicWindow),
+    compositeLayer(compositeLayer),
+    beamBatch(beamBatch),
+    currentStamp(0),
+    beamsChanged(true),
+    lastWindowVisible(false),
+    syncSensors(true)
 {
-    ng::SpriteLoader::preloadTexture(textureFilename);
-    auto& texture = ng::SpriteLoader::getTexture(textureFilename);
-    texture.setSmooth(false);
-    beamWidth = texture.getSize().x;
 }
 
 void LaserSystem::initialize()
@@ -31,15 +35,25 @@ void LaserSystem::initialize()
     tileSize = tileMap.getTileSize();
     mapSize = tileMap.getMapSize();
 
+    // Everything needs to be traced again for a new level
+    blockers.clear();
+    for (auto& hash: blockerHashes)
+        hash.setCellSize(tileSize);
+    beamPaths.clear();
+    beamsChanged = true;
+    syncSensors = true;
+    tileMapData.readChanges(changeCursor, [](int){});
+    lastWindowBounds = magicWindow.getBounds();
+    lastWindowVisible = magicWindow.isVisible();
+
     updateRotations(world);
 }
 
 void LaserSystem::update(float dt)
 {
-    // Store the laser sensors to turn off
-    laserSensorsToDisable.clear();
-    for (int tileId: tileMapData[Tiles::LaserSensor])
-        laserSensorsToDisable.insert(tileId);
+    ++currentStamp;
+    invalidatePaths();
+    updateBlockers();
 
     // Update laser beams
     for (auto ent: world.query<Laser, TilePosition, State>())
@@ -47,15 +61,47 @@ void LaserSystem::update(float dt)
         auto laser = ent.get<Laser>();
         auto tilePos = ent.get<TilePosition>();
         auto state = ent.get<State>();
-        if (state->value)
-            addBeams(*laser, *tilePos);
-        else
+        if (!state->value)
+        {
             laser->beams.clear();
+            laser->looped = false;
+            continue;
+        }
+
+        // Only trace the beams again if something changed
+        auto& path = beamPaths[ent.getId()];
+        path.stamp = currentStamp;
+        if (!isPathCurrent(path, *laser, *tilePos))
+        {
+            addBeams(*laser, *tilePos, path);
+            beamsChanged = true;
+        }
+    }
+
+    // Remove the paths of lasers that were turned off or destroyed
+    for (auto it = beamPaths.begin(); it != beamPaths.end(); )
+    {
+        if (it->second.stamp != currentStamp)
+        {
+            it = beamPaths.erase(it);
+            beamsChanged = true;
+        }
+        else
+            ++it;
     }
 
-    // Turn off the laser sensors in the list
-    for (int tileId: laserSensorsToDisable)
-        es::Events::send(SwitchEvent{tileId, SwitchEvent::Off});
+    // Rebuild the vertices of the beams and switch the laser sensors only if the beams changed
+    if (beamsChanged)
+    {
+        beamBatch.clear();
+        for (auto& laser: world.getComponents<Laser>())
+        {
+            for (const auto& beam: laser.beams)
+                beamBatch.add(beam);
+        }
+        updateSensors();
+        beamsChanged = false;
+    }
 }
 
 void LaserSystem::updateRotations(es::World& world)
@@ -69,6 +115,164 @@ void LaserSystem::updateRotations(es::World& world)
     }
 }
 
+void LaserSystem::invalidatePaths()
+{
+    // Tiles changing state can block, unblock, or redirect the beams crossing them
+    bool continuous = tileMapData.readChanges(changeCursor, [&](int tileId)
+    {
+        int x = tileMapData.getX(tileId);
+        int y = tileMapData.getY(tileId);
+        for (auto& entry: beamPaths)
+        {
+            auto& path = entry.second;
+            for (const auto& segment: path.segments)
+            {
+                if (segment.area.contains(x, y))
+                {
+                    path.valid = false;
+                    break;
+                }
+            }
+        }
+    });
+    if (!continuous)
+    {
+        beamPaths.clear();
+        beamsChanged = true;
+        syncSensors = true;
+    }
+
+    // The window changes which layer is used by the beams under its old and new areas
+    bool visible = magicWindow.isVisible();
+    auto bounds = magicWindow.getBounds();
+    if (visible != lastWindowVisible || (visible && bounds != lastWindowBounds))
+    {
+        if (lastWindowVisible)
+            invalidatePaths(lastWindowBounds, true);
+        if (visible)
+            invalidatePaths(bounds, true);
+    }
+    lastWindowVisible = visible;
+    lastWindowBounds = bounds;
+}
+
+void LaserSystem::invalidatePaths(const sf::FloatRect& bounds, bool windowOnly)
+{
+    // Convert to tiles, including any partially covered tiles
+    int left = std::floor(bounds.left / tileSize.x);
+    int top = std::floor(bounds.top / tileSize.y);
+    int right = std::ceil((bounds.left + bounds.width) / tileSize.x);
+    int bottom = std::ceil((bounds.top + bounds.height) / tileSize.y);
+    sf::IntRect area(left, top, std::max(right - left, 1), std::max(bottom - top, 1));
+
+    for (auto& entry: beamPaths)
+    {
+        auto& path = entry.second;
+        for (const auto& segment: path.segments)
+        {
+            if ((segment.usesWindow || !windowOnly) && segment.area.intersects(area))
+            {
+                path.valid = false;
+                break;
+            }
+        }
+    }
+}
+
+void LaserSystem::updateBlockers()
+{
+    for (auto& hash: blockerHashes)
+        hash.beginUpdate();
+    for (auto ent: world.query<BlocksLaser, AABB, Position>())
+    {
+        // Entities above the window are in both worlds
+        auto bounds = ent.get<AABB>()->getGlobalBounds(ent.getPtr<Position>());
+        bool altWorld = inAltWorld(ent);
+        bool aboveWindow = ent.has<AboveWindow>();
+        bool worlds[] = {!altWorld || aboveWindow, altWorld || aboveWindow};
+
+        // Beams near where the entity was and is now need to be traced again
+        auto found = blockers.find(ent.getId());
+        bool added = (found == blockers.end());
+        auto& blocker = (added ? blockers[ent.getId()] : found->second);
+        if (added || blocker.bounds != bounds || blocker.worlds[0] != worlds[0] || blocker.worlds[1] != worlds[1])
+        {
+            if (!added)
+                invalidatePaths(blocker.bounds, false);
+            invalidatePaths(bounds, false);
+            blocker.bounds = bounds;
+            blocker.worlds[0] = worlds[0];
+            blocker.worlds[1] = worlds[1];
+        }
+        blocker.stamp = currentStamp;
+        for (int layer = 0; layer <= 1; ++layer)
+        {
+            if (blocker.worlds[layer])
+                blockerHashes[layer].update(ent.getId(), bounds);
+        }
+    }
+    for (auto& hash: blockerHashes)
+        hash.endUpdate();
+
+    // Remove entities that were destroyed or stopped blocking lasers
+    for (auto it = blockers.begin(); it != blockers.end(); )
+    {
+        if (it->second.stamp != currentStamp)
+        {
+            invalidatePaths(it->second.bounds, false);
+            it = blockers.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+bool LaserSystem::isPathCurrent(const BeamPath& path, const Laser& laser, const TilePosition& tilePos) const
+{
+    return (path.valid && path.start == tilePos.pos && path.direction == laser.direction &&
+        path.layer == tilePos.layer);
+}
+
+void LaserSystem::updateSensors()
+{
+    // Gather the laser sensors hit by every beam
+    activeSensors.clear();
+    for (const auto& entry: beamPaths)
+        activeSensors.insert(activeSensors.end(), entry.second.sensors.begin(), entry.second.sensors.end());
+    std::sort(activeSensors.begin(), activeSensors.end());
+    activeSensors.erase(std::unique(activeSensors.begin(), activeSensors.end()), activeSensors.end());
+
+    if (syncSensors)
+    {
+        // The states of the sensors aren't known after loading or restarting a level, so set all of them
+        for (int tileId: tileMapData[Tiles::LaserSensor])
+        {
+            bool hit = std::binary_search(activeSensors.begin(), activeSensors.end(), tileId);
+            es::Events::send(SwitchEvent{tileId, hit ? SwitchEvent::On : SwitchEvent::Off});
+        }
+        syncSensors = false;
+    }
+    else
+    {
+        // Only switch the sensors that started or stopped being hit (both lists are sorted)
+        auto active = activeSensors.begin();
+        auto lit = litSensors.begin();
+        while (active != activeSensors.end() || lit != litSensors.end())
+        {
+            if (lit == litSensors.end() || (active != activeSensors.end() && *active < *lit))
+                es::Events::send(SwitchEvent{*active++, SwitchEvent::On});
+            else if (active == activeSensors.end() || *lit < *active)
+                es::Events::send(SwitchEvent{*lit++, SwitchEvent::Off});
+            else
+            {
+                ++active;
+                ++lit;
+            }
+        }
+    }
+    litSensors.swap(activeSensors);
+}
+
 LaserSystem::PointInfo LaserSystem::findPoint()
 {
     PointInfo point;
@@ -88,24 +292,34 @@ LaserSystem::PointInfo LaserSystem::findPoint()
             currentPosition.y > int(mapSize.y) - 1)
             break;
 
-        // Get the layer of the current point depending on the window
-        int layer = getLayer();
-        if (currentLayer == 1)
-            layer = 1;
+        // Skip over the tiles on the same layer that don't block lasers
+        int layer = 0;
+        unsigned count = getRunLength(layer);
+        unsigned distance = tileMapData.findLaserBlocker(layer, currentPosition.x, currentPosition.y, currentDirection, count);
 
-        // Check if there is a laser colliding tile
-        auto& tile = tileMapData(layer, currentPosition.x, currentPosition.y);
-        if (tile.blocksLaser)
+        // Entities in the way stop the beam before the tile
+        if (!blockers.empty() && distance > 0 && findBlocker(layer, distance, point))
+            return point;
+        if (distance == count)
         {
-            done = true;
-            if (tile.logicalId == Tiles::LaserSensor)
-                point.state = PointInfo::State::Activate;
-            else if (tile.logicalId == Tiles::Mirror)
-                point.state = PointInfo::State::Redirect;
-            else
-                point.state = PointInfo::State::Stop;
-            point.tileId = tileMapData.getId(layer, currentPosition.x, currentPosition.y);
+            // Continue from the last tile of the run
+            currentPosition.x += currentDirection.x * int(count - 1);
+            currentPosition.y += currentDirection.y * int(count - 1);
+            continue;
         }
+        currentPosition.x += currentDirection.x * int(distance);
+        currentPosition.y += currentDirection.y * int(distance);
+
+        // Check what kind of laser colliding tile was hit
+        done = true;
+        int logicalId = tileMapData.getLogicalId(layer, currentPosition.x, currentPosition.y);
+        if (logicalId == Tiles::LaserSensor)
+            point.state = PointInfo::State::Activate;
+        else if (logicalId == Tiles::Mirror)
+            point.state = PointInfo::State::Redirect;
+        else
+            point.state = PointInfo::State::Stop;
+        point.tileId = tileMapData.getId(layer, currentPosition.x, currentPosition.y);
     }
 
     // Calculate the graphical position
@@ -124,11 +338,10 @@ LaserSystem::PointInfo LaserSystem::findPoint()
         point.position.y += float(tileSize.y) * ((currentDirection.y - 1) / -2.0f);
     }
 
-    // TODO: Also collide with entities
     return point;
 }
 
-void LaserSystem::addBeams(Laser& laser, TilePosition& tilePos)
+void LaserSystem::addBeams(Laser& laser, TilePosition& tilePos, BeamPath& path)
 {
     // Setup everything
     currentPosition = ng::vec::cast<int>(tilePos.pos);
@@ -137,44 +350,50 @@ void LaserSystem::addBeams(Laser& laser, TilePosition& tilePos)
     // Current layer is the starting layer of the beam
     currentLayer = (tilePos.layer && !getLayer());
 
+    // Start a new path
+    path.valid = true;
+    path.start = tilePos.pos;
+    path.direction = laser.direction;
+    path.layer = tilePos.layer;
+    path.segments.clear();
+    path.sensors.clear();
+    laser.looped = false;
+    visitedMirrors.clear();
+
     // Simulate the laser until it hits something
-    laser.beamCount = 0;
+    laser.beams.clear();
     sf::Vector2f startPoint = tileMap.getCenterPoint<float>(tilePos.pos);
     PointInfo endPoint;
     do
     {
         // Find next point that collides
+        sf::Vector2i segmentStart = currentPosition;
         endPoint = findPoint();
 
-        Laser::Beam* beam;
-        if (laser.beamCount < laser.beams.size())
-        {
-            // Use an existing sprite
-            beam = &(laser.beams[laser.beamCount]);
-        }
-        else
-        {
-            // Setup a new sprite with the beam texture
-            laser.beams.emplace_back();
-            beam = &laser.beams.back();
-            ng::SpriteLoader::load(beam->sprite, textureFilename, true);
-        }
-        ++laser.beamCount;
-
-        beam->sprite.setOrigin(beamWidth / 2, 0);
+        // Remember the tiles this beam crossed (the first tile decides the layer of a laser in the alternate world)
+        Segment segment;
+        segment.area.left = std::min(segmentStart.x, currentPosition.x);
+        segment.area.top = std::min(segmentStart.y, currentPosition.y);
+        segment.area.width = std::abs(currentPosition.x - segmentStart.x) + 1;
+        segment.area.height = std::abs(currentPosition.y - segmentStart.y) + 1;
+        segment.usesWindow = (currentLayer == 0 || (path.segments.empty() && tilePos.layer));
+        path.segments.push_back(segment);
 
-        // Calculate and set the beam length
-        float beamLength = ng::vec::distance(startPoint, endPoint.position);
-        beam->sprite.setScale(1, beamLength);
+        // Add the beam (the vertices are built from these after all of the lasers are updated)
+        laser.beams.emplace_back();
+        auto& beam = laser.beams.back();
+        beam.start = startPoint;
+        beam.end = endPoint.position;
+        beam.direction = currentDirection;
+        beam.layer = currentLayer;
 
-        // Set the beam's position and rotation
-        beam->sprite.setPosition(startPoint);
-        beam->sprite.setRotation(ng::vec::rotateAngle(laser.getAngle(currentDirection), 180.0));
-
-        // Set the beam's layer
-        beam->layer = currentLayer;
-
-        if (endPoint.state == PointInfo::State::Redirect)
+        if (endPoint.state == PointInfo::State::Redirect && !visitMirror(endPoint.tileId))
+        {
+            // The beam would repeat the same path forever
+            endPoint.state = PointInfo::State::Loop;
+            laser.looped = true;
+        }
+        else if (endPoint.state == PointInfo::State::Redirect)
         {
             // Change the direction based on the angle of the mirror
             bool mirrorState = tileMapData(endPoint.tileId).state;
@@ -183,19 +402,119 @@ void LaserSystem::addBeams(Laser& laser, TilePosition& tilePos)
         else if (endPoint.state == PointInfo::State::Activate)
         {
             // Enable the laser sensor
-            es::Events::send(SwitchEvent{endPoint.tileId, SwitchEvent::On});
-            laserSensorsToDisable.erase(endPoint.tileId);
+            path.sensors.push_back(endPoint.tileId);
         }
 
         startPoint = endPoint.position;
     }
-    while (endPoint.state == PointInfo::State::Redirect);
+    while (endPoint.state == PointInfo::State::Redirect && laser.beams.size() < MAX_BEAMS);
+}
+
+bool LaserSystem::findBlocker(int layer, unsigned count, PointInfo& point)
+{
+    // The beam goes through the centers of the tiles, from the edge of the first tile to the edge of the last
+    const auto& dir = currentDirection;
+    sf::Vector2f tile(tileSize.x, tileSize.y);
+    sf::Vector2f start((currentPosition.x + 0.5f) * tile.x - dir.x * tile.x / 2,
+        (currentPosition.y + 0.5f) * tile.y - dir.y * tile.y / 2);
+    float tileLength = (dir.x ? tile.x : tile.y);
+    float length = tileLength * count;
+    sf::Vector2f end(start.x + dir.x * length, start.y + dir.y * length);
+    sf::FloatRect line(std::min(start.x, end.x), std::min(start.y, end.y), std::abs(end.x - start.x), std::abs(end.y - start.y));
+
+    // Only the entities sharing a cell with the beam are tested
+    candidates.clear();
+    blockerHashes[layer].query(line, candidates);
+    bool found = false;
+    float nearest = length;
+    for (auto id: candidates)
+    {
+        const auto& bounds = blockers[id].bounds;
+        float right = bounds.left + bounds.width;
+        float bottom = bounds.top + bounds.height;
+
+        // The entity must cross the line of the beam
+        if (dir.x && (start.y < bounds.top || start.y >= bottom))
+            continue;
+        if (dir.y && (start.x < bounds.left || start.x >= right))
+            continue;
+
+        // Distance along the beam to the near side of the entity
+        float near = (dir.x > 0 ? bounds.left - start.x : dir.x < 0 ? start.x - right :
+            dir.y > 0 ? bounds.top - start.y : start.y - bottom);
+        float far = near + (dir.x ? bounds.width : bounds.height);
+        if (far <= 0 || near >= nearest)
+            continue;
+        nearest = std::max(near, 0.0f);
+        found = true;
+    }
+    if (!found)
+        return false;
+
+    // Stop the beam at the entity, in the tile it is hit in
+    point.position = sf::Vector2f(start.x + dir.x * nearest, start.y + dir.y * nearest);
+    point.state = PointInfo::State::Stop;
+    int tiles = std::min<int>(nearest / tileLength, count - 1);
+    currentPosition.x += dir.x * tiles;
+    currentPosition.y += dir.y * tiles;
+    return true;
+}
+
+bool LaserSystem::visitMirror(int tileId)
+{
+    // Only a few mirrors are hit by most beams, so a linear search is fine
+    unsigned directionIndex = (currentDirection.x ? (currentDirection.x > 0 ? 0 : 1) : (currentDirection.y > 0 ? 2 : 3));
+    std::uint64_t mirror = (std::uint64_t(tileId) << 3) | (directionIndex << 1) | (currentLayer ? 1 : 0);
+    if (std::find(visitedMirrors.begin(), visitedMirrors.end(), mirror) != visitedMirrors.end())
+        return false;
+    visitedMirrors.push_back(mirror);
+    return true;
+}
+
+unsigned LaserSystem::getRunLength(int& layer) const
+{
+    // Distance to the edge of the map
+    const auto& pos = currentPosition;
+    const auto& dir = currentDirection;
+    int length = (dir.x > 0 ? int(mapSize.x) - pos.x : dir.x < 0 ? pos.x + 1 :
+        dir.y > 0 ? int(mapSize.y) - pos.y : pos.y + 1);
+
+    // Beams starting in the alternate world stay there
+    layer = 1;
+    if (currentLayer == 1)
+        return length;
+
+    // Inside of the window, the run ends at the far edge of the window
+    const auto& area = compositeLayer.getWindowArea();
+    int right = area.left + area.width - 1;
+    int bottom = area.top + area.height - 1;
+    if (area.contains(pos))
+    {
+        int windowLength = (dir.x > 0 ? right - pos.x + 1 : dir.x < 0 ? pos.x - area.left + 1 :
+            dir.y > 0 ? bottom - pos.y + 1 : pos.y - area.top + 1);
+        return std::min(length, windowLength);
+    }
+
+    // Outside of the window, the run ends before entering the window (if the beam goes through it)
+    layer = 0;
+    bool crossesWindow = (dir.x != 0 ? pos.y >= area.top && pos.y <= bottom : pos.x >= area.left && pos.x <= right);
+    if (area.width > 0 && area.height > 0 && crossesWindow)
+    {
+        if (dir.x > 0 && area.left > pos.x)
+            length = std::min(length, area.left - pos.x);
+        else if (dir.x < 0 && right < pos.x)
+            length = std::min(length, pos.x - right);
+        else if (dir.y > 0 && area.top > pos.y)
+            length = std::min(length, area.top - pos.y);
+        else if (dir.y < 0 && bottom < pos.y)
+            length = std::min(length, pos.y - bottom);
+    }
+    return length;
 }
 
 int LaserSystem::getLayer() const
 {
-    auto pos = tileMap.getCenterPoint<unsigned>(currentPosition);
-    return (magicWindow.isWithin(pos) ? 1 : 0);
+    return compositeLayer.getLayer(currentPosition.x, currentPosition.y);
 }
 
 void LaserSystem::changeDirection(bool state, sf::Vector2i& direction) const
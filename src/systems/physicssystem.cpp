@@ -5,6 +5,7 @@
 #include "tilemapdata.h"
 #include "nage/graphics/tilemap.h"
 #include "magicwindow.h"
+#include "compositelayer.h"
 #include "components.h"
 #include "es/events.h"
 #include "gameevents.h"
@@ -13,26 +14,45 @@
 #include "nage/misc/utils.h"
 #include "nage/graphics/vectors.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 const sf::Vector2f PhysicsSystem::maxVelocity(3200, 3200);
 const sf::Vector2f PhysicsSystem::gravityConstant(640, 640);
+unsigned PhysicsSystem::threadCount = 0;
 
-PhysicsSystem::PhysicsSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow, Level& level):
+PhysicsSystem::PhysicsSystem(es::World& world, TileMapData& tileMapData, ng::TileMap& tileMap, MagicWindow& magicWindow,
+        CompositeLayer& compositeLayer, Level& level):
     world(world),
     tileMapData(tileMapData),
     tileMap(tileMap),
     magicWindow(magicWindow),
-    level(level)
+    compositeLayer(compositeLayer),
+    level(level),
+    currentStamp(0),
+    lastWindowVisible(false)
 {
 }
 
 void PhysicsSystem::initialize()
 {
+    broadphase.setCellSize(tileMap.getTileSize());
+    bodyStates.clear();
+    sleepStates.clear();
+    tileMapData.readChanges(changeCursor, [](int){});
+    compositeLayer.reset();
     updateTilePositionComponents();
 }
 
+void PhysicsSystem::setThreadCount(unsigned count)
+{
+    threadCount = count;
+}
+
 void PhysicsSystem::update(float dt)
 {
+    compositeLayer.update();
     stepPositions(dt);
     checkEntityCollisions();
     checkTileCollisions();
@@ -53,59 +73,295 @@ void PhysicsSystem::stepPositions(float dt)
     tileMapData.clearTiles();
 
     // Clear events
-    es::Events::clear<CameraEvent>();
+    es::Events::clear<CollisionBeganEvent>();
+    es::Events::clear<CollisionEndedEvent>();
+    es::Events::clear<TileCollisionBeganEvent>();
+    es::Events::clear<TileCollisionEndedEvent>();
 
-    // Apply gravity and handle collisions
+    wakeFromTileChanges();
+
+    // Gather the components of every entity first, since the world can't be changed while stepping
+    unsigned count = 0;
     for (auto ent: world.query<Velocity, Position, Size>())
     {
-        auto entityId = ent.getId();
-        auto velocity = ent.get<Velocity>();
-        auto position = ent.get<Position>();
-        auto size = ent.get<Size>();
+        if (count == stepBodies.size())
+            stepBodies.emplace_back();
+        auto& body = stepBodies[count++];
+        body.id = ent.getId();
+        body.velocity = ent.getPtr<Velocity>();
+        body.position = ent.getPtr<Position>();
+        body.size = ent.getPtr<Size>();
+        body.aabb = ent.getPtr<AABB>();
+        body.gravity = ent.getPtr<Gravity>();
+        body.objectState = ent.getPtr<ObjectState>();
+        body.sleep = (body.aabb ? &sleepStates[body.id] : nullptr);
+        body.altWorld = inAltWorld(ent);
+        body.aboveWindow = ent.has<AboveWindow>();
+        body.restingTiles.clear();
+    }
 
-        // Apply gravity from the gravity component (if it exists)
-        auto gravity = ent.get<Gravity>();
-        if (gravity)
+    // Apply gravity and handle collisions, on multiple threads if there are enough entities
+    unsigned threads = (threadCount ? threadCount : std::max(std::thread::hardware_concurrency(), 1u));
+    if (threads > 1 && count >= BODIES_PER_TASK * 2)
+    {
+        if (!workers || workers->size() != threads)
+            workers.reset(new WorkerPool(threads));
+        unsigned tasks = (count + BODIES_PER_TASK - 1) / BODIES_PER_TASK;
+        workers->run(tasks, [&](std::size_t task)
         {
-            velocity->x += dt * gravity->acceleration.x * gravityConstant.x;
-            velocity->y += dt * gravity->acceleration.y * gravityConstant.y;
-            ng::clamp(velocity->x, -maxVelocity.x, maxVelocity.x);
-            ng::clamp(velocity->y, -maxVelocity.y, maxVelocity.y);
+            unsigned end = std::min<unsigned>((task + 1) * BODIES_PER_TASK, count);
+            for (unsigned i = task * BODIES_PER_TASK; i < end; ++i)
+                stepBody(stepBodies[i], dt);
+        });
+    }
+    else
+    {
+        for (unsigned i = 0; i < count; ++i)
+            stepBody(stepBodies[i], dt);
+    }
+
+    // Merge the tiles with world on them, in query order
+    for (unsigned i = 0; i < count; ++i)
+    {
+        for (int tileId: stepBodies[i].restingTiles)
+            tileMapData.addTile(tileId);
+    }
+}
+
+void PhysicsSystem::stepBody(StepBody& body, float dt) const
+{
+    auto velocity = body.velocity;
+    auto position = body.position;
+
+    // Sleeping entities only need to keep their tiles marked as having something on top
+    auto sleep = body.sleep;
+    if (sleep && sleep->asleep)
+    {
+        if (!shouldWake(body))
+        {
+            body.restingTiles = sleep->restingTiles;
+            return;
         }
+        sleep->asleep = false;
+        sleep->woken = false;
+        sleep->restingTicks = 0;
+    }
+    Position oldPosition = *position;
 
-        // Get the AABB component used for collision detection/handling
-        auto aabb = ent.get<AABB>();
+    // Apply gravity from the gravity component (if it exists)
+    auto gravity = body.gravity;
+    if (gravity)
+    {
+        velocity->x += dt * gravity->acceleration.x * gravityConstant.x;
+        velocity->y += dt * gravity->acceleration.y * gravityConstant.y;
+        ng::clamp(velocity->x, -maxVelocity.x, maxVelocity.x);
+        ng::clamp(velocity->y, -maxVelocity.y, maxVelocity.y);
+    }
 
-        // See if the entity is in the alternate world!
-        bool altWorld = inAltWorld(ent);
+    // Update Y
+    float deltaY = dt * velocity->y;
+    if (body.aabb)
+        deltaY = sweepTiles(body.aabb->getGlobalBounds(position), deltaY, true, body.altWorld);
+    position->y += deltaY;
+    if (body.aabb)
+        handleTileCollision(body, velocity->y, true);
+
+    // Update X
+    float deltaX = dt * velocity->x;
+    if (body.aabb)
+        deltaX = sweepTiles(body.aabb->getGlobalBounds(position), deltaX, false, body.altWorld);
+    position->x += deltaX;
+    if (body.aabb)
+        handleTileCollision(body, velocity->x, false);
+
+    // Fix edge cases
+    updateEdgeCases(body);
+
+    if (sleep)
+    {
+        sleep->restingTiles = body.restingTiles;
+        updateSleep(body, oldPosition);
+    }
+}
 
-        // Update Y
-        position->y += dt * velocity->y;
-        if (aabb)
-            handleTileCollision(aabb.get(), velocity->y, position.get(), true, entityId, altWorld);
+bool PhysicsSystem::shouldWake(const StepBody& body) const
+{
+    // Woken up by a tile changing nearby
+    const auto& sleep = *body.sleep;
+    if (sleep.woken)
+        return true;
+
+    // Moved or pushed by something else (like being picked up by a carrier)
+    const auto& velocity = *body.velocity;
+    const auto& position = *body.position;
+    if (velocity.x != 0 || velocity.y != 0 || position.x != sleep.position.x ||
+        position.y != sleep.position.y || body.altWorld != sleep.altWorld)
+        return true;
+
+    // The magic window could change which tiles are under it
+    if (magicWindow.isWithin(sleep.bounds))
+        return true;
+
+    // Touching something that moved last tick (like a moving platform)
+    auto state = bodyStates.find(body.id);
+    if (state != bodyStates.end())
+    {
+        for (auto id: state->second.contacts)
+        {
+            auto found = bodyIndices.find(id);
+            if (found != bodyIndices.end() && bodies[found->second].moved)
+                return true;
+        }
+    }
 
-        // Update X
-        position->x += dt * velocity->x;
-        if (aabb)
-            handleTileCollision(aabb.get(), velocity->x, position.get(), false, entityId, altWorld);
+    return false;
+}
 
-        // Fix edge cases
-        updateEdgeCases(position.get(), size.get(), velocity->y, entityId);
+void PhysicsSystem::updateSleep(StepBody& body, const Position& oldPosition) const
+{
+    // Entities in the magic window are never at rest, since the tiles under them can change
+    auto& sleep = *body.sleep;
+    const auto& velocity = *body.velocity;
+    const auto& position = *body.position;
+    auto bounds = body.aabb->getGlobalBounds(body.position);
+    bool atRest = (velocity.x == 0 && velocity.y == 0 && position.x == oldPosition.x &&
+        position.y == oldPosition.y && !magicWindow.isWithin(bounds));
+    sleep.restingTicks = (atRest ? sleep.restingTicks + 1 : 0);
+    if (sleep.restingTicks >= SLEEP_TICKS)
+    {
+        sleep.asleep = true;
+        sleep.position = position;
+        sleep.bounds = bounds;
+        sleep.altWorld = body.altWorld;
+    }
+}
+
+void PhysicsSystem::wakeFromTileChanges()
+{
+    changedTiles.clear();
+    bool continuous = tileMapData.readChanges(changeCursor, [&](int tileId){ changedTiles.push_back(tileId); });
+    if (continuous && changedTiles.empty())
+        return;
+
+    // Wake up entities with a changed tile under or next to them (or everything if the log was emptied)
+    const auto& tileSize = tileMap.getTileSize();
+    for (auto& entry: sleepStates)
+    {
+        auto& sleep = entry.second;
+        if (!sleep.asleep)
+            continue;
+        if (!continuous)
+        {
+            sleep.woken = true;
+            continue;
+        }
+        auto area = sleep.bounds;
+        area.left -= tileSize.x;
+        area.top -= tileSize.y;
+        area.width += tileSize.x * 2;
+        area.height += tileSize.y * 2;
+        sf::Vector2u start, end;
+        getCollidingTiles(area, start, end);
+        for (int tileId: changedTiles)
+        {
+            unsigned x = tileMapData.getX(tileId);
+            unsigned y = tileMapData.getY(tileId);
+            if (x >= start.x && x <= end.x && y >= start.y && y <= end.y)
+            {
+                sleep.woken = true;
+                break;
+            }
+        }
+    }
+}
+
+float PhysicsSystem::sweepTiles(const sf::FloatRect& bounds, float delta, bool vertical, bool altWorld) const
+{
+    // Walks the leading edge of an AABB through the rows (or columns) of tiles it moves into,
+    // and stops it partway inside the first collidable tile so the overlap gets resolved normally
+    // This way, moving more than a tile in one step can't skip over walls
+    if (delta == 0)
+        return delta;
+
+    const auto& tileSize = tileMap.getTileSize();
+    const auto& mapSize = tileMap.getMapSize();
+    float mainTile = (vertical ? tileSize.y : tileSize.x);
+    float crossTile = (vertical ? tileSize.x : tileSize.y);
+    int mainCount = (vertical ? mapSize.y : mapSize.x);
+    int crossCount = (vertical ? mapSize.x : mapSize.y);
+    float mainStart = (vertical ? bounds.top : bounds.left);
+    float mainSize = (vertical ? bounds.height : bounds.width);
+    float crossStart = (vertical ? bounds.left : bounds.top);
+    float crossSize = (vertical ? bounds.width : bounds.height);
+
+    // The tiles along the other axis that the AABB overlaps
+    int crossFirst = std::max(static_cast<int>(std::floor(crossStart / crossTile)), 0);
+    int crossLast = std::min(static_cast<int>(std::ceil((crossStart + crossSize) / crossTile)) - 1, crossCount - 1);
+    if (crossFirst > crossLast)
+        return delta;
+
+    // The tiles the leading edge moves into (not counting one it is already inside of)
+    bool forward = (delta > 0);
+    float edge = (forward ? mainStart + mainSize : mainStart);
+    float newEdge = edge + delta;
+    int first = (forward ? std::ceil(edge / mainTile) : std::floor(edge / mainTile) - 1);
+    int last = (forward ? std::ceil(newEdge / mainTile) - 1 : std::floor(newEdge / mainTile));
+    if (forward)
+    {
+        first = std::max(first, 0);
+        last = std::min(last, mainCount - 1);
+        if (first > last)
+            return delta;
+    }
+    else
+    {
+        first = std::min(first, mainCount - 1);
+        last = std::max(last, 0);
+        if (first < last)
+            return delta;
+    }
 
-        // Send camera update event
-        if (ent.has<CameraUpdater>())
-            es::Events::send(CameraEvent{sf::Vector2f(position->x, position->y),
-                                         sf::Vector2f(size->x, size->y)});
+    const float maxPenetration = mainTile / 2;
+    for (int i = first; ; i += (forward ? 1 : -1))
+    {
+        if (isBlocked(i, crossFirst, crossLast, vertical, altWorld))
+        {
+            float contact = (forward ? i * mainTile : (i + 1) * mainTile);
+            float limit = (forward ? contact + maxPenetration : contact - maxPenetration);
+            return ((forward ? newEdge > limit : newEdge < limit) ? limit - edge : delta);
+        }
+        if (i == last)
+            break;
+    }
+    return delta;
+}
+
+bool PhysicsSystem::isBlocked(unsigned mainIndex, unsigned crossStart, unsigned crossEnd, bool vertical, bool altWorld) const
+{
+    // Checks a row (or column) of tiles with the same layer rules as handleTileCollision()
+    if (vertical && !tileMapData.anyCollidable(1, mainIndex, crossStart, crossEnd) &&
+        (altWorld || !tileMapData.anyCollidable(0, mainIndex, crossStart, crossEnd)))
+        return false;
+    for (unsigned i = crossStart; i <= crossEnd; ++i)
+    {
+        unsigned x = (vertical ? i : mainIndex);
+        unsigned y = (vertical ? mainIndex : i);
+        if (tileMapData.isCollidable(determineLayer(altWorld, true, x, y), x, y))
+            return true;
     }
+    return false;
 }
 
-void PhysicsSystem::handleTileCollision(AABB* entAABB, float& velocity, Position* position, bool vertical, es::ID entityId, bool altWorld)
+void PhysicsSystem::handleTileCollision(StepBody& body, float& velocity, bool vertical) const
 {
     // Object - tile map collision
     // Need to send an event when this happens so the entity knows which tile it is colliding with
     // And it would send what kind of event: falling off platform, standing on platform, etc.
 
     // Temp computed AABB (position + AABB component)
+    auto entAABB = body.aabb;
+    auto position = body.position;
+    bool altWorld = body.altWorld;
     auto tempAABB = entAABB->getGlobalBounds(position);
     float newTop = tempAABB.top;
 
@@ -114,20 +370,21 @@ void PhysicsSystem::handleTileCollision(AABB* entAABB, float& velocity, Position
     sf::Vector2u end;
     getCollidingTiles(tempAABB, start, end);
 
-    auto ent = world[entityId];
-    bool aboveWindow = ent.has<AboveWindow>();
-
     // Check the collision
     bool onPlatform = false;
     const auto& tileSize = tileMap.getTileSize();
     for (unsigned y = start.y; y <= end.y; ++y)
     {
+        // Skip rows without any collidable tiles in the layers this object could touch
+        if (!tileMapData.anyCollidable(1, y, start.x, end.x) &&
+            (altWorld || !tileMapData.anyCollidable(0, y, start.x, end.x)))
+            continue;
+
         for (unsigned x = start.x; x <= end.x; ++x)
         {
             // Find which layer this object is part of
             int layer = determineLayer(altWorld, true, x, y);
-            tileMapData.useLayer(layer);
-            if (tileMapData(x, y).collidable)
+            if (tileMapData.isCollidable(layer, x, y))
             {
                 auto tileBox = tileMap.getBoundingBox(x, y);
                 if (tileBox.intersects(tempAABB))
@@ -139,9 +396,9 @@ void PhysicsSystem::handleTileCollision(AABB* entAABB, float& velocity, Position
                             newTop = y * tileSize.y - tempAABB.height;
                             onPlatform = true;
 
-                            // Add the tile ID to the set of tiles with world on them
-                            int newLayer = determineLayer(altWorld, aboveWindow, x, y - 1);
-                            tileMapData.addTile(tileMapData.getId(newLayer, x, y - 1));
+                            // Remember the tile above, since it has world on top of it
+                            int newLayer = determineLayer(altWorld, body.aboveWindow, x, y - 1);
+                            body.restingTiles.push_back(tileMapData.getId(newLayer, x, y - 1));
                         }
                         else // Hitting ceiling
                             tempAABB.top = (y + 1) * tileSize.y;
@@ -164,110 +421,270 @@ void PhysicsSystem::handleTileCollision(AABB* entAABB, float& velocity, Position
         tempAABB.top = newTop;
 
     // Notify the entity about it being in the air or on a platform
-    if (vertical && ent)
-        updateOnPlatformState(entityId, onPlatform ? ObjectState::OnPlatform : ObjectState::InAir);
+    if (vertical && body.objectState)
+        body.objectState->state = (onPlatform ? ObjectState::OnPlatform : ObjectState::InAir);
 
     // Update the position from the new AABB
     position->x = tempAABB.left - entAABB->rect.left;
     position->y = tempAABB.top - entAABB->rect.top;
 }
 
-void PhysicsSystem::updateEdgeCases(Position* position, Size* size, float& velocity, es::ID entityId)
+void PhysicsSystem::updateEdgeCases(StepBody& body) const
 {
+    auto position = body.position;
+    auto size = body.size;
     auto levelSize = tileMap.getPixelSize();
     sf::Vector2i newPosition(levelSize.x - size->x, levelSize.y - size->y);
 
     // Ensure that entities won't move outside of the level
     ng::clampLT(position->x, 0);
     if (ng::clampLT(position->y, 0))
-        velocity = 0;
+        body.velocity->y = 0;
     ng::clampGT(position->x, newPosition.x);
-    if (ng::clampGT(position->y, newPosition.y))
-        updateOnPlatformState(entityId, ObjectState::OnPlatform);
+    if (ng::clampGT(position->y, newPosition.y) && body.objectState)
+        body.objectState->state = ObjectState::OnPlatform;
 }
 
 void PhysicsSystem::checkEntityCollisions()
 {
     // TODO: Add "rigid" properties: Completely solid, and collidable only on the top
     // TODO: Handle collisions between collidable (rigid) components
-    // TODO: Use a quad-tree or some spatial partitioning to improve performance
 
-    // Use an O(n^2) algorithm to detect collisions between entities
-    // Update the collision lists on any colliding components
-    auto entities = world.query<AABB, Position>();
-    for (auto& ent1: entities)
+    // Compute the bounds and world/window states once per entity,
+    // and move the entities around in the broadphase
+    bool movedWindow = windowMoved();
+    bodies.clear();
+    bodyIndices.clear();
+    broadphase.beginUpdate();
+    ++currentStamp;
+    for (auto ent: world.query<AABB, Position>())
     {
-        auto& aabb = *ent1.getPtr<AABB>();
-        aabb.collisions.clear();
-        for (auto& ent2: entities)
+        CollisionBody body;
+        body.id = ent.getId();
+        body.aabb = ent.getPtr<AABB>();
+        body.bounds = body.aabb->getGlobalBounds(ent.getPtr<Position>());
+        body.altWorld = inAltWorld(ent);
+        body.drawOnTop = ent.has<DrawOnTop>();
+        body.inWindow = magicWindow.isWithin(body.bounds);
+
+        // Compare with the last frame to see if anything about the entity changed
+        auto inserted = bodyStates.emplace(body.id, BodyState());
+        auto& state = inserted.first->second;
+        if (inserted.second)
         {
-            if (ent1.getId() != ent2.getId())
-            {
-                // TODO: Dynamically build a new world when moving the window
-                    // This will make things 100% accurate and much simpler (no crazy boolean logic like below)
-
-                auto& aabb2 = *ent2.getPtr<AABB>();
-                auto pos = ent1.get<Position>();
-                auto pos2 = ent2.get<Position>();
-
-                bool drawOnTop = ent1.has<DrawOnTop>();
-                bool drawOnTop2 = ent2.has<DrawOnTop>();
-                bool altWorld = inAltWorld(ent1);
-                bool altWorld2 = inAltWorld(ent2);
-                bool inWindow = magicWindow.isWithin(aabb.getGlobalBounds(pos.get()));
-                bool inWindow2 = magicWindow.isWithin(aabb2.getGlobalBounds(pos2.get()));
-
-                bool case1 = (altWorld == inWindow && altWorld2 == inWindow2); // "Real world"
-                bool case2 = ((altWorld && !inWindow) && (altWorld2 && !inWindow2)); // "Alternate world"
-                bool case3 = (!altWorld && drawOnTop && inWindow && altWorld2 && inWindow2); // An object on top, like the player
-                bool case4 = (!altWorld2 && drawOnTop2 && inWindow2 && altWorld && inWindow); // Another object on top
-                bool case5 = (!altWorld && drawOnTop && inWindow && !altWorld2 && drawOnTop2 && inWindow2); // Both world on top and in window
-
-                if (case1 || case2 || case3 || case4 || case5)
-                {
-                    if (aabb.getGlobalBounds(pos.get()).intersects(aabb2.getGlobalBounds(pos2.get())))
-                        aabb.collisions.push_back(ent2.getId());
-                }
-            }
+            // The lists could be left over from a copied entity
+            body.aabb->collisions.clear();
+            body.aabb->tileCollisions.clear();
+        }
+        body.moved = (inserted.second || state.bounds != body.bounds || state.altWorld != body.altWorld ||
+            state.drawOnTop != body.drawOnTop || state.inWindow != body.inWindow);
+        body.tilesChanged = (body.moved || (movedWindow && body.inWindow));
+        state.bounds = body.bounds;
+        state.altWorld = body.altWorld;
+        state.drawOnTop = body.drawOnTop;
+        state.inWindow = body.inWindow;
+        state.stamp = currentStamp;
+
+        bodyIndices[body.id] = bodies.size();
+        bodies.push_back(body);
+        broadphase.update(body.id, body.bounds);
+    }
+    broadphase.endUpdate();
+    removeOldBodies();
+
+    // Check the contacts of entities that changed
+    // Only entities sharing a cell are tested, in the same order as the query
+    for (unsigned i = 0; i < bodies.size(); ++i)
+    {
+        auto& body = bodies[i];
+        if (!body.moved)
+            continue;
+
+        candidateIds.clear();
+        broadphase.query(body.bounds, candidateIds);
+        candidates.clear();
+        for (auto id: candidateIds)
+        {
+            auto found = bodyIndices.find(id);
+            if (found != bodyIndices.end() && found->second != i)
+                candidates.push_back(found->second);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        newContacts.clear();
+        for (unsigned j: candidates)
+        {
+            auto& body2 = bodies[j];
+            if (canCollide(body, body2) && body.bounds.intersects(body2.bounds))
+                newContacts.push_back(body2.id);
+        }
+
+        // Compare with the old contacts (these are also updated from the other entity's side, so they are copied first)
+        auto& contacts = bodyStates[body.id].contacts;
+        oldContacts.assign(contacts.begin(), contacts.end());
+        for (auto id: oldContacts)
+        {
+            if (std::find(newContacts.begin(), newContacts.end(), id) == newContacts.end())
+                endContact(body.id, id);
+        }
+        for (auto id: newContacts)
+        {
+            if (std::find(oldContacts.begin(), oldContacts.end(), id) == oldContacts.end())
+                beginContact(i, id);
+        }
+    }
+}
+
+void PhysicsSystem::removeOldBodies()
+{
+    // End the contacts of entities that were destroyed or lost their components
+    for (auto it = bodyStates.begin(); it != bodyStates.end(); )
+    {
+        if (it->second.stamp != currentStamp)
+        {
+            oldContacts.assign(it->second.contacts.begin(), it->second.contacts.end());
+            for (auto id: oldContacts)
+                endContact(it->first, id);
+            for (int tileId: it->second.tiles)
+                es::Events::send(TileCollisionEndedEvent{it->first, tileId});
+            sleepStates.erase(it->first);
+            it = bodyStates.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void PhysicsSystem::beginContact(unsigned index, es::ID otherId)
+{
+    auto entityId = bodies[index].id;
+    bodyStates[entityId].contacts.push_back(otherId);
+    bodyStates[otherId].contacts.push_back(entityId);
+    addCollision(entityId, otherId);
+    addCollision(otherId, entityId);
+    es::Events::send(CollisionBeganEvent{entityId, otherId});
+}
+
+void PhysicsSystem::endContact(es::ID entityId, es::ID otherId)
+{
+    for (auto& pair: {std::make_pair(entityId, otherId), std::make_pair(otherId, entityId)})
+    {
+        auto found = bodyStates.find(pair.first);
+        if (found != bodyStates.end())
+        {
+            auto& contacts = found->second.contacts;
+            contacts.erase(std::remove(contacts.begin(), contacts.end(), pair.second), contacts.end());
+            removeCollision(pair.first, pair.second);
         }
     }
+    es::Events::send(CollisionEndedEvent{entityId, otherId});
+}
+
+void PhysicsSystem::addCollision(es::ID entityId, es::ID otherId)
+{
+    // Keep the list in query order, so the first colliding entity doesn't depend on when it started touching
+    auto index = bodyIndices.find(entityId);
+    if (index == bodyIndices.end())
+        return;
+    auto getIndex = [&](es::ID id)
+    {
+        auto found = bodyIndices.find(id);
+        return (found != bodyIndices.end() ? found->second : bodies.size());
+    };
+    auto& collisions = bodies[index->second].aabb->collisions;
+    auto otherIndex = getIndex(otherId);
+    auto position = std::upper_bound(collisions.begin(), collisions.end(), otherIndex,
+        [&](std::size_t value, es::ID id){ return (value < getIndex(id)); });
+    collisions.insert(position, otherId);
+}
+
+void PhysicsSystem::removeCollision(es::ID entityId, es::ID otherId)
+{
+    auto index = bodyIndices.find(entityId);
+    if (index == bodyIndices.end())
+        return;
+    auto& collisions = bodies[index->second].aabb->collisions;
+    auto found = std::find(collisions.begin(), collisions.end(), otherId);
+    if (found != collisions.end())
+        collisions.erase(found);
+}
+
+bool PhysicsSystem::windowMoved()
+{
+    bool visible = magicWindow.isVisible();
+    auto bounds = magicWindow.getBounds();
+    bool moved = (visible != lastWindowVisible || (visible && bounds != lastWindowBounds));
+    lastWindowVisible = visible;
+    lastWindowBounds = bounds;
+    return moved;
+}
+
+bool PhysicsSystem::canCollide(const CollisionBody& body, const CollisionBody& body2)
+{
+    // TODO: Dynamically build a new world when moving the window
+        // This will make things 100% accurate and much simpler (no crazy boolean logic like below)
+
+    bool drawOnTop = body.drawOnTop;
+    bool drawOnTop2 = body2.drawOnTop;
+    bool altWorld = body.altWorld;
+    bool altWorld2 = body2.altWorld;
+    bool inWindow = body.inWindow;
+    bool inWindow2 = body2.inWindow;
+
+    bool case1 = (altWorld == inWindow && altWorld2 == inWindow2); // "Real world"
+    bool case2 = ((altWorld && !inWindow) && (altWorld2 && !inWindow2)); // "Alternate world"
+    bool case3 = (!altWorld && drawOnTop && inWindow && altWorld2 && inWindow2); // An object on top, like the player
+    bool case4 = (!altWorld2 && drawOnTop2 && inWindow2 && altWorld && inWindow); // Another object on top
+    bool case5 = (!altWorld && drawOnTop && inWindow && !altWorld2 && drawOnTop2 && inWindow2); // Both world on top and in window
+
+    return (case1 || case2 || case3 || case4 || case5);
 }
 
 void PhysicsSystem::checkTileCollisions()
 {
     // Generate lists of tile coordinates colliding with AABB components
     // TODO: This may only be useful for the player, so make an optional flag or component to enable it
-    for (auto ent: world.query<AABB, Position>())
+    for (auto& body: bodies)
     {
-        auto aabb = ent.get<AABB>();
-        auto position = ent.get<Position>();
-        aabb->tileCollisions.clear();
-        if (position)
+        if (!body.tilesChanged)
+            continue;
+
+        newTiles.clear();
+        sf::Vector2u start, end;
+        getCollidingTiles(body.bounds, start, end);
+        for (unsigned y = start.y; y <= end.y; ++y)
         {
-            sf::Vector2u start, end;
-            auto globalBounds = aabb->getGlobalBounds(position.get());
-            getCollidingTiles(globalBounds, start, end);
-            bool inWindow = magicWindow.isWithin(globalBounds);
-            for (unsigned y = start.y; y <= end.y; ++y)
+            for (unsigned x = start.x; x <= end.x; ++x)
             {
-                for (unsigned x = start.x; x <= end.x; ++x)
-                {
-                    // Figure out which layer the tile is in
-                    int layer = (inWindow && magicWindow.isWithin(tileMap.getCenterPoint<unsigned>(x, y)));
-                    int tileId = tileMapData.getId(layer, x, y);
+                // Figure out which layer the tile is in
+                int layer = (body.inWindow ? compositeLayer.getLayer(x, y) : 0);
 
-                    // Add the tile ID to the collision list
-                    if (tileMapData(tileId).logicalId > 0)
-                        aabb->tileCollisions.push_back(tileId);
-                }
+                // Add the tile ID to the collision list
+                if (tileMapData.getLogicalId(layer, x, y) > 0)
+                    newTiles.push_back(tileMapData.getId(layer, x, y));
             }
         }
+
+        // Send events for the tiles that changed
+        auto& tiles = bodyStates[body.id].tiles;
+        for (int tileId: tiles)
+        {
+            if (std::find(newTiles.begin(), newTiles.end(), tileId) == newTiles.end())
+                es::Events::send(TileCollisionEndedEvent{body.id, tileId});
+        }
+        for (int tileId: newTiles)
+        {
+            if (std::find(tiles.begin(), tiles.end(), tileId) == tiles.end())
+                es::Events::send(TileCollisionBeganEvent{body.id, tileId});
+        }
+        tiles = newTiles;
+        body.aabb->tileCollisions = newTiles;
     }
 }
 
 int PhysicsSystem::determineLayer(bool altWorld, bool aboveWindow, unsigned x, unsigned y) const
 {
-    return (altWorld || (aboveWindow && magicWindow.isWithin(tileMap.getCenterPoint<unsigned>(x, y))));
+    return (altWorld || (aboveWindow && compositeLayer.getLayer(x, y)));
 }
 
 void PhysicsSystem::updateTilePositionComponents()
@@ -332,14 +749,7 @@ void PhysicsSystem::updateTilePositionComponents()
     }
 }
 
-void PhysicsSystem::updateOnPlatformState(es::ID entityId, int state)
-{
-    auto objectState = world[entityId].get<ObjectState>();
-    if (objectState)
-        objectState->state = state;
-}
-
-void PhysicsSystem::getCollidingTiles(const sf::FloatRect& entAABB, sf::Vector2u& start, sf::Vector2u& end)
+void PhysicsSystem::getCollidingTiles(const sf::FloatRect& entAABB, sf::Vector2u& start, sf::Vector2u& end) const
 {
     const auto& tileSize = tileMap.getTileSize();
     const auto& mapSize = tileMap.getMapSize();
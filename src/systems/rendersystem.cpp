@@ -6,13 +6,14 @@
 #include "nage/graphics/camera.h"
 #include "magicwindow.h"
 #include "nage/graphics/views.h"
-#include "lasercomponent.h"
+#include "beambatch.h"
 #include "level.h"
 #include "gamesavehandler.h"
+#include "virtualfilesystem.h"
 #include <iostream>
 
 RenderSystem::RenderSystem(es::World& world, ng::TileMap& tileMap, ng::TileMap& smoothTileMap,
-        sf::RenderWindow& window, ng::Camera& camera, MagicWindow& magicWindow, const Level& level,
+        sf::RenderWindow& window, ng::Camera& camera, MagicWindow& magicWindow, const BeamBatch& beamBatch, const Level& level,
         const GameSaveHandler& gameSave):
     world(world),
     tileMap(tileMap),
@@ -20,6 +21,7 @@ RenderSystem::RenderSystem(es::World& world, ng::TileMap& tileMap, ng::TileMap&
     window(window),
     camera(camera),
     magicWindow(magicWindow),
+    beamBatch(beamBatch),
     level(level),
     gameSave(gameSave)
 {
@@ -27,7 +29,7 @@ RenderSystem::RenderSystem(es::World& world, ng::TileMap& tileMap, ng::TileMap&
     sprites.loadFromConfig("data/config/sprites.cfg");
 
     // Setup sf::Text objects
-    if (!font.loadFromFile("data/fonts/Ubuntu-B.ttf"))
+    if (!VirtualFileSystem::loadResource("data/fonts/Ubuntu-B.ttf", font, fontData))
     {
         std::cerr << "Error loading font file: 'data/fonts/Ubuntu-B.ttf'\n";
         exit(1);
@@ -103,7 +105,7 @@ void RenderSystem::update(float dt)
         drawSprite<AnimSprite>(ent);
 
     // Draw laser beams
-    drawLasers(1);
+    beamBatch.draw(*texture, 1);
 
     // Finish drawing the render texture for the magic window
     texture->display();
@@ -118,7 +120,7 @@ void RenderSystem::update(float dt)
         drawSprite<Sprite>(ent, true);
 
     // Draw laser beams
-    drawLasers(0);
+    beamBatch.draw(window, 0);
 
     // Draw level name/number text
     window.setView(uiView);
@@ -127,20 +129,3 @@ void RenderSystem::update(float dt)
 
     window.display();
 }
-
-void RenderSystem::drawLasers(int layer)
-{
-    for (auto& laser: world.getComponents<Laser>())
-    {
-        for (unsigned i = 0; i < laser.beams.size() && i < laser.beamCount; ++i)
-        {
-            if (laser.beams[i].layer == layer)
-            {
-                if (layer)
-                    texture->draw(laser.beams[i].sprite);
-                else
-                    window.draw(laser.beams[i].sprite);
-            }
-        }
-    }
-}
@@ -6,14 +6,26 @@
 #include <SFML/Graphics.hpp>
 #include "components.h"
 #include "es/world.h"
+#include "es/events.h"
+#include "gameevents.h"
+#include "positionhistory.h"
 
-SpriteSystem::SpriteSystem(es::World& world):
-    world(world)
+SpriteSystem::SpriteSystem(es::World& world, const PositionHistory& positionHistory):
+    world(world),
+    positionHistory(positionHistory)
 {
 }
 
 void SpriteSystem::update(float dt)
 {
+    // Send camera update events
+    es::Events::clear<CameraEvent>();
+    for (auto ent: world.query<CameraUpdater, Position, Size>())
+    {
+        auto size = ent.getPtr<Size>();
+        es::Events::send(CameraEvent{positionHistory.get(ent), sf::Vector2f(size->x, size->y)});
+    }
+
     // Update sprites
     for (auto ent: world.query<Sprite>())
     {
@@ -51,9 +63,8 @@ void SpriteSystem::updateRotations(es::World& world)
 void SpriteSystem::setPosition(es::Entity& ent, sf::Transformable& sprite)
 {
     // Update position
-    auto position = ent.get<Position>();
-    if (position)
-        sprite.setPosition(position->x, position->y);
+    if (ent.has<Position>())
+        sprite.setPosition(positionHistory.get(ent));
 }
 
 void SpriteSystem::setRotation(es::Entity& ent, sf::Transformable& sprite)
@@ -8,15 +8,16 @@
 #include "tilemapdata.h"
 #include "es/events.h"
 #include "gameevents.h"
+#include "virtualfilesystem.h"
 #include <iostream>
 #include <algorithm>
 
 TileSmoothingSystem::TileSmoothingSystem(es::World& world, const TileMapData& tileMapData, ng::TileMap& smoothTileMap):
-    mappings("data/config/smooth_mappings.cfg"),
     world(world),
     tileMapData(tileMapData),
     smoothTileMap(smoothTileMap)
 {
+    VirtualFileSystem::loadConfig("data/config/smooth_mappings.cfg", mappings);
 }
 
 void TileSmoothingSystem::initialize()
@@ -25,16 +26,26 @@ void TileSmoothingSystem::initialize()
     const auto size = tileMapData.size();
     smoothTileMap.resize(size.x * 2, size.y * 2);
 
-    // Update all tiles
+    // Start with every tile blank
     const auto smoothSize = smoothTileMap.getMapSize();
     for (unsigned layer = 0; layer <= 1; ++layer)
     {
         for (unsigned y = 0; y < smoothSize.y; ++y)
         {
             for (unsigned x = 0; x < smoothSize.x; ++x)
-                updateTile(layer, x, y);
+                smoothTileMap.set(layer, x, y, getBlankTile(layer));
         }
     }
+
+    // Update the tiles under non-empty tiles
+    for (unsigned layer = 0; layer <= 1; ++layer)
+    {
+        tileMapData.forEachTile(layer, [&](unsigned x, unsigned y)
+        {
+            for (unsigned i = 0; i < 4; ++i)
+                updateTile(layer, x * 2 + i % 2, y * 2 + i / 2);
+        });
+    }
 }
 
 void TileSmoothingSystem::update(float dt)
@@ -70,10 +81,10 @@ void TileSmoothingSystem::updateTile(int layer, int x, int y)
         return;
 
     // Only generate tiles for platform tiles
-    if (tileMapData(layer, x / 2, y / 2).logicalId != Tiles::Normal)
+    if (tileMapData.getLogicalId(layer, x / 2, y / 2) != Tiles::Normal)
     {
         // Make it blank and skip
-        smoothTileMap.set(layer, x, y, 14 + (layer * 18));
+        smoothTileMap.set(layer, x, y, getBlankTile(layer));
         return;
     }
 
@@ -100,8 +111,13 @@ void TileSmoothingSystem::updateTile(int layer, int x, int y)
     smoothTileMap.set(layer, x, y, id);
 }
 
+int TileSmoothingSystem::getBlankTile(int layer) const
+{
+    return (14 + (layer * 18));
+}
+
 char TileSmoothingSystem::getKey(int layer, int x, int y) const
 {
-    unsigned platformTile = (tileMapData.inBounds(x, y) && tileMapData(layer, x, y).logicalId == Tiles::Normal);
+    unsigned platformTile = (tileMapData.inBounds(x, y) && tileMapData.getLogicalId(layer, x, y) == Tiles::Normal);
     return (platformTile + '0');
 }
@@ -9,6 +9,7 @@
 #include "components.h"
 #include "es/world.h"
 #include <iostream>
+#include <algorithm>
 
 TileSystem::TileSystem(es::World& world, TileMapData& tileMapData):
     world(world),
@@ -16,25 +17,46 @@ TileSystem::TileSystem(es::World& world, TileMapData& tileMapData):
 {
 }
 
+void TileSystem::initialize()
+{
+    // The physics system sends new collision events for every tile after it is initialized
+    actionTiles.clear();
+}
+
 void TileSystem::update(float dt)
 {
+    // Keep track of the tiles with actions that entities start and stop touching
+    for (auto& event: es::Events::get<TileCollisionEndedEvent>())
+    {
+        auto found = actionTiles.find(event.entityId);
+        if (found != actionTiles.end())
+        {
+            auto& tiles = found->second;
+            tiles.erase(std::remove(tiles.begin(), tiles.end(), event.tileId), tiles.end());
+            if (tiles.empty())
+                actionTiles.erase(found);
+        }
+    }
+    for (auto& event: es::Events::get<TileCollisionBeganEvent>())
+    {
+        int logicalId = tileMapData(event.tileId).logicalId;
+        if (logicalId == Tiles::Exit || logicalId == Tiles::ToggleSwitch)
+            actionTiles[event.entityId].push_back(event.tileId);
+    }
+
     // Handle action key events (when the player presses "up") on different tiles
     for (auto& event: es::Events::get<ActionKeyEvent>())
     {
-        auto aabb = world[event.entityId].get<AABB>();
-        if (aabb)
+        auto found = actionTiles.find(event.entityId);
+        if (found == actionTiles.end())
+            continue;
+        for (int tileId: found->second)
         {
-            for (int tileId: aabb->tileCollisions)
-            {
-                // Get the logical ID
-                int logicalId = tileMapData(tileId).logicalId;
-
-                // Handle the action event depending on which tile type it is
-                if (logicalId == Tiles::Exit)
-                    handleExitTile();
-                else if (logicalId == Tiles::ToggleSwitch)
-                    es::Events::send(SwitchEvent{tileId, SwitchEvent::Toggle});
-            }
+            // Handle the action event depending on which tile type it is
+            if (tileMapData(tileId).logicalId == Tiles::Exit)
+                handleExitTile();
+            else
+                es::Events::send(SwitchEvent{tileId, SwitchEvent::Toggle});
         }
     }
 }
@@ -0,0 +1,106 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "assetpack.h"
+#include "leveldata.h"
+#include <fstream>
+#include <iterator>
+#include <iostream>
+
+const std::string LEVEL_INDEX_FILENAME = "data/levels/index.cfg";
+
+bool readFile(const std::string& filename, std::string& data)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool isTextLevel(const std::string& filename)
+{
+    const std::string levelDir = "data/levels/";
+    const std::string extension = ".cfg";
+    return (filename.compare(0, levelDir.size(), levelDir) == 0 &&
+        filename.size() > levelDir.size() + extension.size() &&
+        filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0 &&
+        filename != LEVEL_INDEX_FILENAME);
+}
+
+// Adds the name and size of a level to the level index
+void addToLevelIndex(const std::string& filename, cfg::File& index)
+{
+    cfg::File config(filename, LevelData::defaultOptions);
+    if (!config.getStatus())
+    {
+        std::cerr << "Error loading level file: " << filename << "\n";
+        return;
+    }
+    LevelData level;
+    level.loadFromConfig(config);
+
+    index.useSection(filename);
+    index("name") = level.name;
+    index("width") = static_cast<int>(level.width);
+    index("height") = static_cast<int>(level.height);
+}
+
+// Packs files (relative to the working directory) into a single archive, along with an index of all levels
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " output.pack file...\n";
+        return 1;
+    }
+
+    std::vector<AssetPack::File> files;
+    cfg::File levelIndex;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string filename = argv[i];
+        if (filename == LEVEL_INDEX_FILENAME)
+            continue;
+        AssetPack::File file{filename, ""};
+        if (!readFile(filename, file.data))
+        {
+            std::cerr << "Error reading file: " << filename << "\n";
+            return 1;
+        }
+        files.push_back(std::move(file));
+        if (isTextLevel(filename))
+            addToLevelIndex(filename, levelIndex);
+    }
+
+    AssetPack::File indexFile{LEVEL_INDEX_FILENAME, ""};
+    levelIndex.writeToString(indexFile.data);
+    files.push_back(std::move(indexFile));
+
+    if (!AssetPack::write(argv[1], files))
+    {
+        std::cerr << "Error writing asset pack: " << argv[1] << "\n";
+        return 1;
+    }
+
+    // Make sure everything can be read back
+    AssetPack pack;
+    if (!pack.open(argv[1]))
+    {
+        std::cerr << "Error opening asset pack: " << argv[1] << "\n";
+        return 1;
+    }
+    for (auto& file: files)
+    {
+        const char* data = nullptr;
+        std::size_t size = 0;
+        if (!pack.find(file.name, data, size) || std::string(data, size) != file.data)
+        {
+            std::cerr << "File does not match in asset pack: " << file.name << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "Packed " << files.size() << " files into " << argv[1] << "\n";
+    return 0;
+}
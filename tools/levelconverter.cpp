@@ -0,0 +1,74 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "leveldata.h"
+#include <iostream>
+
+// Converts a text level file to a binary level file next to it, and verifies both formats
+bool convertLevel(const std::string& filename)
+{
+    // Load the text level
+    cfg::File config(filename, LevelData::defaultOptions);
+    if (!config.getStatus())
+    {
+        std::cerr << "Error loading level file: " << filename << "\n";
+        return false;
+    }
+    LevelData level;
+    if (!level.loadFromConfig(config))
+    {
+        std::cerr << "Invalid tiles in level file: " << filename << "\n";
+        return false;
+    }
+
+    // Write the binary level
+    auto binaryFilename = filename.substr(0, filename.rfind('.')) + ".bin";
+    if (!level.saveToBinaryFile(binaryFilename))
+    {
+        std::cerr << "Error saving binary level file: " << binaryFilename << "\n";
+        return false;
+    }
+
+    // Make sure the binary level has the same contents
+    LevelData binaryLevel;
+    if (!binaryLevel.loadFromBinaryFile(binaryFilename) || binaryLevel != level)
+    {
+        std::cerr << "Binary level does not match: " << binaryFilename << "\n";
+        return false;
+    }
+
+    // Make sure the text format can be written back without losing anything
+    std::string text;
+    cfg::File outConfig(LevelData::defaultOptions);
+    binaryLevel.saveToConfig(outConfig);
+    outConfig.writeToString(text);
+    cfg::File inConfig(LevelData::defaultOptions);
+    inConfig.loadFromString(text);
+    LevelData textLevel;
+    textLevel.loadFromConfig(inConfig);
+    if (textLevel != level)
+    {
+        std::cerr << "Text level does not match after saving: " << filename << "\n";
+        return false;
+    }
+
+    std::cout << "Converted " << filename << " to " << binaryFilename << "\n";
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " level.cfg...\n";
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!convertLevel(argv[i]))
+            ++failed;
+    }
+    return (failed ? 1 : 0);
+}
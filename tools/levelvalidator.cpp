@@ -0,0 +1,221 @@
+// Copyright (C) 2014-2015 Eric Hebert (ayebear)
+// This code is licensed under GPLv3, see LICENSE.txt for details.
+
+#include "level.h"
+#include "leveldata.h"
+#include "tilemapdata.h"
+#include "tilemapchanger.h"
+#include "magicwindow.h"
+#include "tilesmoothingsystem.h"
+#include "gamecomponents.h"
+#include "virtualfilesystem.h"
+#include "workerpool.h"
+#include "nage/graphics/tilemap.h"
+#include "nage/actions/actionhandler.h"
+#include "es/world.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+using Clock = std::chrono::steady_clock;
+
+// Everything needed to load a level, without a window
+struct Instance
+{
+    Instance();
+
+    ng::ActionHandler actions;
+    TileMapData tileMapData;
+    ng::TileMap tileMap;
+    ng::TileMap smoothTileMap;
+    TileMapChanger tileMapChanger;
+    MagicWindow magicWindow;
+    es::World world;
+    Level level;
+    TileSmoothingSystem smoothing;
+};
+
+Instance::Instance():
+    tileMapChanger(tileMapData, tileMap),
+    magicWindow(actions),
+    level(tileMapData, tileMap, tileMapChanger, world, magicWindow),
+    smoothing(world, tileMapData, smoothTileMap)
+{
+    tileMap.loadFromConfig("data/config/tilemap.cfg");
+    smoothTileMap.loadFromConfig("data/config/smooth_tilemap.cfg");
+}
+
+struct Result
+{
+    std::string filename;
+    std::string error;
+    double parseTime{};
+    double loadTime{};
+    double deriveTime{};
+    double smoothTime{};
+    double saveTime{};
+};
+
+double getMilliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool parseLevel(const std::string& data, LevelData& level)
+{
+    cfg::File config(LevelData::defaultOptions);
+    return (config.loadFromString(data) && level.loadFromConfig(config));
+}
+
+// Entities are saved in world order, so they are sorted before levels are compared
+void sortEntities(LevelData& level)
+{
+    std::sort(level.entities.begin(), level.entities.end(),
+        [](const LevelData::Entity& a, const LevelData::Entity& b){ return a.name < b.name; });
+}
+
+// Describes the first difference between two levels
+std::string describeDifference(const LevelData& original, const LevelData& saved)
+{
+    if (original.name != saved.name)
+        return "name changed from \"" + original.name + "\" to \"" + saved.name + "\"";
+    if (original.width != saved.width || original.height != saved.height)
+        return "size changed";
+    for (int layer = 0; layer <= 1; ++layer)
+    {
+        for (unsigned i = 0; i < original.width * original.height; ++i)
+        {
+            if (original.logicalIds[layer][i] != saved.logicalIds[layer][i] ||
+                original.visualIds[layer][i] != saved.visualIds[layer][i])
+            {
+                return "tile changed at layer " + std::to_string(layer) + " (" +
+                    std::to_string(i % original.width) + ", " + std::to_string(i / original.width) + ")";
+            }
+        }
+    }
+    if (original.entities.size() != saved.entities.size())
+        return "entity count changed from " + std::to_string(original.entities.size()) +
+            " to " + std::to_string(saved.entities.size());
+    for (unsigned i = 0; i < original.entities.size(); ++i)
+    {
+        if (!(original.entities[i] == saved.entities[i]))
+            return "entity changed: " + original.entities[i].name;
+    }
+    return "";
+}
+
+void validateLevel(Instance& instance, Result& result)
+{
+    std::string original;
+    if (!VirtualFileSystem::read(result.filename, original))
+    {
+        result.error = "could not read file";
+        return;
+    }
+
+    // Parse the level on this thread, then load it like the game does (Level creates entities one thread at a time)
+    LevelData originalLevel;
+    auto start = Clock::now();
+    if (!parseLevel(original, originalLevel))
+    {
+        result.error = "could not parse level";
+        return;
+    }
+    result.parseTime = getMilliseconds(start);
+    start = Clock::now();
+    instance.level.load(originalLevel);
+    result.loadTime = getMilliseconds(start);
+
+    // Time the derived layers and smoothing on their own
+    start = Clock::now();
+    instance.tileMapData.deriveTiles();
+    result.deriveTime = getMilliseconds(start);
+    start = Clock::now();
+    instance.smoothing.initialize();
+    result.smoothTime = getMilliseconds(start);
+
+    // Save it back, and make sure nothing was lost
+    std::string saved;
+    start = Clock::now();
+    instance.level.saveToString(saved);
+    result.saveTime = getMilliseconds(start);
+
+    LevelData savedLevel;
+    if (!parseLevel(saved, savedLevel))
+        result.error = "could not parse saved level";
+    else
+    {
+        sortEntities(originalLevel);
+        sortEntities(savedLevel);
+        if (originalLevel != savedLevel)
+            result.error = describeDifference(originalLevel, savedLevel);
+    }
+
+    instance.level.clear();
+}
+
+// Loads, derives, smooths and saves levels in parallel, and reports any differences after saving
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " level.cfg...\n";
+        return 1;
+    }
+
+    VirtualFileSystem::mount("assets.pack");
+    if (!setupGameComponents())
+    {
+        std::cerr << "Error loading object prototypes\n";
+        return 1;
+    }
+
+    std::vector<Result> results(argc - 1);
+    for (int i = 1; i < argc; ++i)
+        results[i - 1].filename = argv[i];
+
+    // Each thread takes an instance while it is validating a level
+    WorkerPool pool;
+    std::vector<std::unique_ptr<Instance>> instances;
+    for (unsigned i = 0; i < std::min<std::size_t>(pool.size(), results.size()); ++i)
+        instances.emplace_back(new Instance());
+    std::vector<Instance*> freeInstances;
+    for (auto& instance: instances)
+        freeInstances.push_back(instance.get());
+    std::mutex instanceMutex;
+
+    auto start = Clock::now();
+    pool.run(results.size(), [&](std::size_t i)
+    {
+        Instance* instance = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(instanceMutex);
+            instance = freeInstances.back();
+            freeInstances.pop_back();
+        }
+        validateLevel(*instance, results[i]);
+        std::lock_guard<std::mutex> lock(instanceMutex);
+        freeInstances.push_back(instance);
+    });
+    double totalTime = getMilliseconds(start);
+
+    // Report the results
+    unsigned failed = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\nLevel                          Parse(ms)  Load(ms)  Derive(ms)  Smooth(ms)  Save(ms)  Result\n";
+    for (auto& result: results)
+    {
+        std::cout << std::left << std::setw(30) << result.filename << std::right
+            << std::setw(10) << result.parseTime << std::setw(10) << result.loadTime << std::setw(12) << result.deriveTime
+            << std::setw(12) << result.smoothTime << std::setw(10) << result.saveTime << "  "
+            << (result.error.empty() ? "OK" : result.error) << "\n";
+        if (!result.error.empty())
+            ++failed;
+    }
+    std::cout << "Validated " << results.size() << " levels on " << pool.size() << " threads in "
+        << totalTime << " ms, " << failed << " failed\n";
+    return (failed ? 1 : 0);
+}